@@ -0,0 +1,166 @@
+/*
+ * Connected components benchmark: measures the parallel engine on edge lists and on CSR graphs against merging
+ * the edges one by one into the sequential UnionFind, on generated RMAT graphs (skewed degrees, a giant component
+ * and many isolated vertices, with the vertex numbers scrambled) and grid graphs (every vertex of degree four,
+ * numbered row by row). The times in seconds and the throughputs in millions of edges per second are printed
+ * as CSV. The sequential baseline labels the vertices in the same order as the engine. The parallel methods are run
+ * on one thread and on the given number of threads, by default the hardware concurrency.
+ * An RMAT graph of scale 24 with the default edge factor has 268M edges, which take 2 GB, and its CSR
+ * graph as much again; --no-csr leaves the CSR methods out.
+ *
+ * Usage: bench_connected_components [--scale LOG2_VERTICES] [--edge-factor EDGES_PER_VERTEX] [--grid-side N]
+ *                                   [--repeat N] [--threads N] [--no-csr]
+ * */
+
+#include "connected_components.h"
+#include "union_find.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/* Random bits of the number i, from a counter-based generator. */
+static inline std::uint64_t random_bits(std::uint64_t i)
+{
+    std::uint64_t z = (i + 1) * 0x9E3779B97F4A7C15u;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+}
+
+/* RMAT graph of 2^scale vertices (Graph500 parameters a = 0.57, b = c = 0.19): each edge descends the quadrants
+ * of the adjacency matrix, one bit of both ends per level. The vertex numbers are scrambled by a multiplication
+ * with an odd constant, so that the high-degree vertices are not the first ones. */
+static std::vector<GraphEdge> gen_rmat(unsigned scale, std::size_t nr_edges)
+{
+    const std::uint32_t mask = static_cast<std::uint32_t>((std::uint64_t(1) << scale) - 1);
+    std::vector<GraphEdge> edges (nr_edges);
+    for (std::size_t i = 0; i < nr_edges; ++i) {
+        std::uint32_t u = 0, v = 0;
+        std::uint64_t bits = 0;
+        for (unsigned level = 0; level < scale; ++level) {
+            if (level % 4 == 0)
+                bits = random_bits(i * 8 + level / 4);
+            const std::uint32_t r = bits & 0xFFFF; // 16 bits per level, compared with the quadrant probabilities
+            bits >>= 16;
+            u = u << 1 | (r >= 49807);
+            v = v << 1 | ((r >= 37355 && r < 49807) || r >= 62259);
+        }
+        edges[i] = {(u * 2654435761u) & mask, (v * 2654435761u) & mask};
+    }
+    return edges;
+}
+
+/* Grid graph of side x side vertices, with the edges to the right and down neighbors. */
+static std::vector<GraphEdge> gen_grid(std::uint32_t side)
+{
+    std::vector<GraphEdge> edges;
+    edges.reserve(2 * std::size_t(side) * side);
+    for (std::uint32_t y = 0; y < side; ++y)
+        for (std::uint32_t x = 0; x < side; ++x) {
+            if (x + 1 < side)
+                edges.push_back({y * side + x, y * side + x + 1});
+            if (y + 1 < side)
+                edges.push_back({y * side + x, (y + 1) * side + x});
+        }
+    return edges;
+}
+
+
+/* Run the function the given number of times and return the best time in seconds. */
+template<typename Function>
+static double best_seconds(int repeat, Function&& function)
+{
+    double best = 1e100;
+    for (int i = 0; i < repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+int main(int argc, char *argv[])
+{
+    unsigned scale = 22;
+    std::size_t edge_factor = 16;
+    std::uint32_t grid_side = 4096;
+    int repeat = 3;
+    unsigned nr_threads = std::max(1u, std::thread::hardware_concurrency());
+    bool csr = true;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--scale" && i + 1 < argc)
+            scale = std::clamp(std::stoi(argv[++i]), 1, 31);
+        else if (arg == "--edge-factor" && i + 1 < argc)
+            edge_factor = std::stoull(argv[++i]);
+        else if (arg == "--grid-side" && i + 1 < argc)
+            grid_side = std::clamp(std::stoi(argv[++i]), 1, 65535);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            nr_threads = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--no-csr")
+            csr = false;
+    }
+
+    std::cout << "graph,vertices,edges,method,threads,seconds,medges_per_s\n";
+    for (const std::string graph : {"rmat", "grid"}) {
+        const std::size_t nr_vertices = graph == "rmat" ? std::size_t(1) << scale : std::size_t(grid_side) * grid_side;
+        const std::vector<GraphEdge> edges = graph == "rmat" ? gen_rmat(scale, edge_factor << scale) : gen_grid(grid_side);
+        auto report = [&](const char *method, unsigned threads, double seconds)
+        {
+            std::cout << graph << ',' << nr_vertices << ',' << edges.size() << ',' << method << ',' << threads << ','
+                      << seconds << ',' << edges.size() / seconds / 1e6 << std::endl;
+        };
+
+        std::size_t expected_count = 0;
+        report("union_find", 1, best_seconds(repeat, [&]
+                    {
+                        UnionFind<std::uint32_t> uf (nr_vertices);
+                        for (auto [u, v] : edges)
+                            uf.merge(u, v);
+                        std::vector<std::uint32_t> labels (nr_vertices, UINT32_MAX);
+                        expected_count = 0;
+                        for (std::uint32_t v = 0; v < nr_vertices; ++v) {
+                            const std::uint32_t root = uf.find(v);
+                            if (labels[root] == UINT32_MAX)
+                                labels[root] = static_cast<std::uint32_t>(expected_count++);
+                            labels[v] = labels[root];
+                        }
+                    }));
+        auto check = [&](const char *method, const ConnectedComponents& components)
+        {
+            if (components.count != expected_count)
+                std::cerr << "warning: " << method << " found " << components.count << " components instead of "
+                          << expected_count << std::endl;
+        };
+
+        for (unsigned threads : {1u, nr_threads}) {
+            ConnectedComponents components;
+            report("edges", threads, best_seconds(repeat, [&] { components = connected_components(edges, nr_vertices, threads); }));
+            check("edges", components);
+            if (threads == nr_threads)
+                break;
+        }
+        if (!csr)
+            continue;
+        for (unsigned threads : {1u, nr_threads}) {
+            CsrGraph csr_graph;
+            report("build_csr", threads, best_seconds(repeat, [&] { csr_graph = build_csr(edges, nr_vertices, threads); }));
+            ConnectedComponents components;
+            report("csr", threads, best_seconds(repeat, [&] { components = connected_components(csr_graph, threads); }));
+            check("csr", components);
+            if (threads == nr_threads)
+                break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,249 @@
+/*
+ * Huffman coding benchmark: measures the throughput of each stage of the Huffman module
+ * (histogram, tree build, table build, encoding and decoding), the compression ratio
+ * and the throughput of block encoding, which picks the block mode by the entropy estimate,
+ * on generated data sets and on the files given on the command line.
+ * The results are printed as CSV, or as JSON with --json.
+ *
+ * Usage: bench_huffman_coding [--size BYTES] [--repeat N] [--json] [FILE...]
+ * */
+
+#include "huffman_coding.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+struct DataSet {
+    std::string name;
+    std::string data;
+};
+
+struct Result {
+    std::string name;
+    size_t size = 0;
+    size_t compressed_size = 0;
+    double histogram = 0, tree_build = 0, table_build = 0, encode = 0, decode = 0; // MB/s
+    const char *block_mode = "";
+    double block_encode = 0; // MB/s
+};
+
+
+/* English-like text: words picked with a skewed distribution, separated by spaces and punctuation. */
+static std::string gen_text(size_t size, std::mt19937& rng)
+{
+    static const char *const words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+        "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an",
+        "had", "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there",
+        "compression", "algorithm", "entropy", "symbol", "frequency", "Huffman", "corpus", "stream",
+    };
+    constexpr size_t nr_words = sizeof(words) / sizeof(words[0]);
+    std::geometric_distribution<size_t> word_dist(0.12);
+
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        text += words[std::min(word_dist(rng), nr_words - 1)];
+        const auto r = rng() % 16;
+        text += r == 0 ? ". " : r == 1 ? ", " : r == 2 ? "\n" : " ";
+    }
+    text.resize(size);
+    return text;
+}
+
+/* Binary records: an incrementing counter, a small random field and a float, as raw bytes. */
+static std::string gen_binary(size_t size, std::mt19937& rng)
+{
+    std::string data;
+    data.reserve(size + 16);
+    for (uint32_t counter = 0; data.size() < size; ++counter) {
+        const uint16_t small = static_cast<uint16_t>(rng() % 64);
+        const float value = static_cast<float>(rng() % 1000) / 8;
+        char record[sizeof(counter) + sizeof(small) + sizeof(value)];
+        std::memcpy(record, &counter, sizeof(counter));
+        std::memcpy(record + sizeof(counter), &small, sizeof(small));
+        std::memcpy(record + sizeof(counter) + sizeof(small), &value, sizeof(value));
+        data.append(record, sizeof(record));
+    }
+    data.resize(size);
+    return data;
+}
+
+/* One symbol appears 90% of the time, the rest is spread over a few others. */
+static std::string gen_skewed(size_t size, std::mt19937& rng)
+{
+    std::string data(size, 'a');
+    for (char& c : data)
+        if (rng() % 10 == 0)
+            c = static_cast<char>('b' + rng() % 16);
+    return data;
+}
+
+/* Uniformly distributed bytes: incompressible. */
+static std::string gen_uniform(size_t size, std::mt19937& rng)
+{
+    std::string data(size, '\0');
+    for (char& c : data)
+        c = static_cast<char>(rng());
+    return data;
+}
+
+
+/* Run the function the given number of times and return the best time in seconds. */
+template<typename Function>
+static double best_seconds(int repeat, Function&& function)
+{
+    double best = 1e100;
+    for (int i = 0; i < repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+static Result run(const DataSet& data_set, int repeat)
+{
+    const std::string& data = data_set.data;
+    const double megabytes = data.size() / 1e6;
+    Result result {data_set.name, data.size()};
+
+    std::unordered_map<char, size_t> sym_freq;
+    result.histogram = megabytes / best_seconds(repeat, [&]
+            {
+                sym_freq = count_sym_freq(data.begin(), data.end());
+            });
+
+    std::unique_ptr<HuffmanTree<char>> tree;
+    result.tree_build = megabytes / best_seconds(repeat, [&]
+            {
+                tree = build_huffman_tree(sym_freq);
+            });
+
+    HuffmanTable<char> table;
+    result.table_build = megabytes / best_seconds(repeat, [&]
+            {
+                table = build_huffman_table(tree.get());
+            });
+
+    const HuffmanDictionary<char> dictionary {std::move(tree)};
+    std::string encoded;
+    result.encode = megabytes / best_seconds(repeat, [&]
+            {
+                std::ostringstream oss {std::ios_base::binary};
+                HuffmanEncoder<char> encoder {oss, dictionary};
+                encoder.write_syms(data.begin(), data.end());
+                encoder.finalize();
+                encoded = oss.str();
+            });
+    result.compressed_size = encoded.size();
+
+    std::string decoded(data.size(), '\0');
+    result.decode = megabytes / best_seconds(repeat, [&]
+            {
+                std::istringstream iss {encoded, std::ios_base::binary};
+                HuffmanDecoder<char> decoder {iss, dictionary};
+                decoder.read_syms(decoded.begin(), decoded.end());
+            });
+    if (decoded != data)
+        std::cerr << "warning: " << data_set.name << " did not survive the round trip" << std::endl;
+
+    HuffmanBlockMode block_mode = HuffmanBlockMode::Huffman;
+    result.block_encode = megabytes / best_seconds(repeat, [&]
+            {
+                std::ostringstream oss {std::ios_base::binary};
+                block_mode = huffman_encode_block(oss, data.begin(), data.end());
+            });
+    result.block_mode = block_mode == HuffmanBlockMode::Stored ? "stored"
+        : block_mode == HuffmanBlockMode::SingleSymbol ? "single_symbol" : "huffman";
+
+    return result;
+}
+
+
+static void print_csv(const std::vector<Result>& results)
+{
+    std::cout << "data_set,size,compressed_size,ratio,histogram_mbps,tree_build_mbps,"
+        "table_build_mbps,encode_mbps,decode_mbps,block_mode,block_encode_mbps\n";
+    for (const Result& r : results) {
+        std::cout << r.name << ',' << r.size << ',' << r.compressed_size << ','
+            << static_cast<double>(r.size) / r.compressed_size << ',' << r.histogram << ','
+            << r.tree_build << ',' << r.table_build << ',' << r.encode << ',' << r.decode << ','
+            << r.block_mode << ',' << r.block_encode << '\n';
+    }
+}
+
+static void print_json(const std::vector<Result>& results)
+{
+    std::cout << "[\n";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& r = results[i];
+        std::cout << "  {\"data_set\": \"" << r.name << "\", \"size\": " << r.size
+            << ", \"compressed_size\": " << r.compressed_size
+            << ", \"ratio\": " << static_cast<double>(r.size) / r.compressed_size
+            << ", \"histogram_mbps\": " << r.histogram << ", \"tree_build_mbps\": " << r.tree_build
+            << ", \"table_build_mbps\": " << r.table_build << ", \"encode_mbps\": " << r.encode
+            << ", \"decode_mbps\": " << r.decode << ", \"block_mode\": \"" << r.block_mode
+            << "\", \"block_encode_mbps\": " << r.block_encode << '}' << (i + 1 < results.size() ? "," : "") << '\n';
+    }
+    std::cout << "]\n";
+}
+
+
+int main(int argc, char *argv[])
+{
+    size_t size = 16 << 20;
+    int repeat = 3;
+    bool json = false;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            size = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--json")
+            json = true;
+        else
+            files.push_back(arg);
+    }
+
+    std::mt19937 rng;
+    std::vector<DataSet> data_sets = {
+        {"text", gen_text(size, rng)},
+        {"binary", gen_binary(size, rng)},
+        {"skewed", gen_skewed(size, rng)},
+        {"uniform", gen_uniform(size, rng)},
+    };
+    for (const std::string& file : files) {
+        std::ifstream ifs {file, std::ios_base::binary};
+        if (!ifs) {
+            std::cerr << "error: cannot open " << file << std::endl;
+            return 1;
+        }
+        data_sets.push_back({file, {std::istreambuf_iterator<char>(ifs), std::istreambuf_iterator<char>()}});
+    }
+
+    std::vector<Result> results;
+    for (const DataSet& data_set : data_sets) {
+        if (data_set.data.empty()) {
+            std::cerr << "warning: skipping empty data set " << data_set.name << std::endl;
+            continue;
+        }
+        results.push_back(run(data_set, repeat));
+    }
+
+    json ? print_json(results) : print_csv(results);
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Substring search benchmark: measures the throughput of each search backend (KMP, the KMP DFA,
+ * Boyer-Moore-Horspool, Two-Way, the vectorized search and the automatic selection) on data sets
+ * with different alphabets and for different pattern sizes. The patterns are cut from an independently
+ * generated text of the same kind, so most of them do not occur and the whole text is scanned.
+ * The results, in GB/s, are printed as CSV; they are what the thresholds of select_str_find_backend are based on.
+ *
+ * Usage: bench_kmp_pattern_search [--size BYTES] [--repeat N]
+ * */
+
+#include "kmp_pattern_search.h"
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+
+struct DataSet {
+    const char *name;
+    std::string (*generate)(std::size_t size, std::mt19937& rng);
+};
+
+struct Backend {
+    const char *name;
+    std::function<std::size_t(std::string_view, std::string_view)> find;
+};
+
+
+/* English-like text: words picked with a skewed distribution, separated by spaces. */
+static std::string gen_text(std::size_t size, std::mt19937& rng)
+{
+    static const char *const words[] = {
+        "the", "of", "and", "to", "in", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+        "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an",
+        "pattern", "search", "algorithm", "string", "matching", "automaton", "prefix", "suffix",
+    };
+    constexpr std::size_t nr_words = sizeof(words) / sizeof(words[0]);
+    std::geometric_distribution<std::size_t> word_dist(0.12);
+
+    std::string text;
+    text.reserve(size + 16);
+    while (text.size() < size) {
+        text += words[std::min(word_dist(rng), nr_words - 1)];
+        text += ' ';
+    }
+    text.resize(size);
+    return text;
+}
+
+/* DNA-like text: four letters, uniformly distributed. */
+static std::string gen_dna(std::size_t size, std::mt19937& rng)
+{
+    std::string text (size, '\0');
+    for (char& c : text)
+        c = "ACGT"[rng() % 4];
+    return text;
+}
+
+/* Text over eight letters, uniformly distributed. */
+static std::string gen_octal(std::size_t size, std::mt19937& rng)
+{
+    std::string text (size, '\0');
+    for (char& c : text)
+        c = '0' + rng() % 8;
+    return text;
+}
+
+/* Binary text: two letters. */
+static std::string gen_binary(std::size_t size, std::mt19937& rng)
+{
+    std::string text (size, '\0');
+    for (char& c : text)
+        c = '0' + rng() % 2;
+    return text;
+}
+
+/* Uniformly distributed bytes. */
+static std::string gen_uniform(std::size_t size, std::mt19937& rng)
+{
+    std::string text (size, '\0');
+    for (char& c : text)
+        c = static_cast<char>(rng());
+    return text;
+}
+
+
+/* Run the function the given number of times and return the best time in seconds. */
+template<typename Function>
+static double best_seconds(int repeat, Function&& function)
+{
+    double best = 1e100;
+    for (int i = 0; i < repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        function();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::size_t size = 16 << 20;
+    int repeat = 3;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            size = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+    }
+
+    const DataSet data_sets[] = {
+        {"text", gen_text}, {"octal", gen_octal}, {"dna", gen_dna}, {"binary", gen_binary}, {"uniform", gen_uniform},
+    };
+    const Backend backends[] = {
+        {"kmp", [](std::string_view str, std::string_view pat) { return kmp_str_find(str, pat); }},
+        {"kmp_dfa", kmp_dfa_str_find},
+        {"horspool", horspool_str_find},
+        {"two_way", two_way_str_find},
+        {"fast", [](std::string_view str, std::string_view pat) { return fast_str_find(str, pat); }},
+        {"auto", str_find},
+    };
+    const std::size_t pattern_sizes[] = {2, 4, 8, 16, 32, 64, 256};
+
+    std::cout << "data_set,pattern_size";
+    for (const Backend& backend : backends)
+        std::cout << ',' << backend.name << "_gbps";
+    std::cout << ",auto_backend\n";
+
+    std::mt19937 rng;
+    for (const DataSet& data_set : data_sets) {
+        const std::string text = data_set.generate(size, rng);
+        const std::string source = data_set.generate(1 << 16, rng);
+        for (std::size_t pattern_size : pattern_sizes) {
+            const std::string pattern = source.substr(rng() % (source.size() - pattern_size), pattern_size);
+            const std::size_t expected = text.find(pattern);
+
+            std::cout << data_set.name << ',' << pattern_size;
+            for (const Backend& backend : backends) {
+                std::size_t found;
+                const double seconds = best_seconds(repeat, [&] { found = backend.find(text, pattern); });
+                if (found != expected)
+                    std::cerr << "warning: " << backend.name << " found a wrong match" << std::endl;
+                const std::size_t scanned = expected == std::string::npos ? text.size() : expected + pattern_size;
+                std::cout << ',' << scanned / seconds / 1e9;
+            }
+            std::cout << ',' << to_string(select_str_find_backend(pattern)) << '\n';
+        }
+    }
+    return 0;
+}
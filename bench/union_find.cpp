@@ -0,0 +1,171 @@
+/*
+ * Union-find benchmark: measures the merges and the connectivity queries of each linking and compression
+ * variant of UnionFind on two merge sequences. "random" merges random pairs of elements, so almost every
+ * step of a find is a cache miss once the forest outgrows the caches. "binomial" is the adversarial case
+ * for union by size or rank: it merges blocks of equal size pairwise, round by round, which builds trees of
+ * the maximum height log2(size) for the queries to compress. The results, in nanoseconds per operation,
+ * are printed as CSV. The forest takes 8 bytes per element, so the 100M-element run needs about 800 MB.
+ * The concurrent forests are run on one thread and on the given number of threads, which split the operations
+ * of each phase; the default is the hardware concurrency.
+ *
+ * Usage: bench_union_find [--size ELEMENTS] [--repeat N] [--threads N]
+ * */
+
+#include "union_find.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+
+
+/* Random bits of the operation number i: a counter-based generator, so that the threads can take any range
+ * of the same sequence of operations, and cheap next to the cache misses. */
+static inline std::uint64_t random_bits(std::uint64_t i)
+{
+    std::uint64_t z = (i + 1) * 0x9E3779B97F4A7C15u;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9u;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBu;
+    return z ^ (z >> 31);
+}
+
+/* Map 32 random bits to [0, size). */
+static inline int bounded(std::uint64_t bits, std::size_t size)
+{
+    return static_cast<int>((bits & 0xFFFFFFFFu) * size >> 32);
+}
+
+/* Split [0, size) into nr_threads ranges, call function(begin, end) on each from its own thread,
+ * and return the sum of the results. */
+template<typename Function>
+static std::size_t parallel_sum(unsigned nr_threads, std::size_t size, Function&& function)
+{
+    if (nr_threads <= 1)
+        return function(std::size_t(0), size);
+    std::vector<std::size_t> sums (nr_threads);
+    std::vector<std::thread> threads;
+    for (unsigned t = 0; t < nr_threads; ++t)
+        threads.emplace_back([&, t]
+                {
+                    sums[t] = function(size * t / nr_threads, size * (t + 1) / nr_threads);
+                });
+    for (std::thread& thread : threads)
+        thread.join();
+    return std::accumulate(sums.begin(), sums.end(), std::size_t(0));
+}
+
+
+/* Merge size random pairs of elements; return the number of merges that joined two sets. */
+template<typename UF>
+static std::size_t merge_random(UF& uf, unsigned nr_threads)
+{
+    return parallel_sum(nr_threads, uf.size(), [&uf](std::size_t begin, std::size_t end)
+            {
+                std::size_t nr_joined = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const std::uint64_t bits = random_bits(i);
+                    nr_joined += uf.merge(bounded(bits, uf.size()), bounded(bits >> 32, uf.size()));
+                }
+                return nr_joined;
+            });
+}
+
+/* Merge the blocks of 2^k elements pairwise for k = 0, 1, ..., through the first elements of the blocks,
+ * which are their roots; every tree ends up a binomial tree of the maximum height. The threads split
+ * each round. */
+template<typename UF>
+static std::size_t merge_binomial(UF& uf, unsigned nr_threads)
+{
+    std::size_t nr_joined = 0;
+    for (std::size_t half = 1; half < uf.size(); half *= 2)
+        nr_joined += parallel_sum(nr_threads, (uf.size() - half + 2 * half - 1) / (2 * half),
+                [&uf, half](std::size_t begin, std::size_t end)
+                {
+                    std::size_t nr_joined = 0;
+                    for (std::size_t block = begin; block < end; ++block)
+                        nr_joined += uf.merge(static_cast<int>(2 * half * block), static_cast<int>(2 * half * block + half));
+                    return nr_joined;
+                });
+    return nr_joined;
+}
+
+/* Ask whether size random pairs of elements are connected; return the number of connected ones. */
+template<typename UF>
+static std::size_t query_random(UF& uf, unsigned nr_threads)
+{
+    return parallel_sum(nr_threads, uf.size(), [&uf](std::size_t begin, std::size_t end)
+            {
+                std::size_t nr_connected = 0;
+                for (std::size_t i = begin; i < end; ++i) {
+                    const std::uint64_t bits = random_bits(i + uf.size());
+                    nr_connected += uf.connected(bounded(bits, uf.size()), bounded(bits >> 32, uf.size()));
+                }
+                return nr_connected;
+            });
+}
+
+
+/* Time the merge and the query phases of a data set on a fresh forest, keeping the best of the repetitions;
+ * print the times and return the checksum of the phases, which must not depend on the variant. */
+template<typename UF>
+static std::size_t run(const char *data_set, const char *variant, std::size_t size, int repeat, unsigned nr_threads)
+{
+    double best_merge = 1e100, best_query = 1e100;
+    std::size_t checksum = 0;
+    for (int i = 0; i < repeat; ++i) {
+        UF uf (size);
+        const auto start = std::chrono::steady_clock::now();
+        const std::size_t nr_joined = std::string(data_set) == "random" ? merge_random(uf, nr_threads)
+                                                                        : merge_binomial(uf, nr_threads);
+        const auto middle = std::chrono::steady_clock::now();
+        const std::size_t nr_connected = query_random(uf, nr_threads);
+        const auto end = std::chrono::steady_clock::now();
+        best_merge = std::min(best_merge, std::chrono::duration<double>(middle - start).count());
+        best_query = std::min(best_query, std::chrono::duration<double>(end - middle).count());
+        checksum = nr_joined * 31 + nr_connected;
+    }
+    std::cout << data_set << ',' << variant << ',' << nr_threads << ','
+              << best_merge / size * 1e9 << ',' << best_query / size * 1e9 << '\n';
+    return checksum;
+}
+
+
+int main(int argc, char *argv[])
+{
+    std::size_t size = 16 << 20;
+    int repeat = 3;
+    unsigned nr_threads = std::max(1u, std::thread::hardware_concurrency());
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            size = std::stoull(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(1, std::stoi(argv[++i]));
+        else if (arg == "--threads" && i + 1 < argc)
+            nr_threads = std::max(1, std::stoi(argv[++i]));
+    }
+
+    using enum UnionFindLinking;
+    using enum UnionFindCompression;
+    using enum ConcurrentUnionFindLinking;
+    std::cout << "data_set,variant,threads,merge_ns,query_ns\n";
+    for (const char *data_set : {"random", "binomial"}) {
+        const std::size_t checksums[] = {
+            run<UnionFind<int, BySize, Halving>>(data_set, "size_halving", size, repeat, 1),
+            run<UnionFind<int, BySize, Splitting>>(data_set, "size_splitting", size, repeat, 1),
+            run<UnionFind<int, ByRank, Halving>>(data_set, "rank_halving", size, repeat, 1),
+            run<UnionFind<int, ByRank, Splitting>>(data_set, "rank_splitting", size, repeat, 1),
+            run<ConcurrentUnionFind<int, ByIndex>>(data_set, "concurrent_index", size, repeat, 1),
+            run<ConcurrentUnionFind<int, ByIndex>>(data_set, "concurrent_index", size, repeat, nr_threads),
+            run<ConcurrentUnionFind<int, ByRandomIndex>>(data_set, "concurrent_random_index", size, repeat, 1),
+            run<ConcurrentUnionFind<int, ByRandomIndex>>(data_set, "concurrent_random_index", size, repeat, nr_threads),
+        };
+        if (std::count(std::begin(checksums), std::end(checksums), checksums[0]) != std::ssize(checksums))
+            std::cerr << "warning: the variants disagree on " << data_set << std::endl;
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+/*
+ * Aho-Corasick multi-pattern search automaton
+ * */
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+
+/* Aho-Corasick automaton: the KMP failure function generalized from a single pattern to a trie of patterns,
+ * which finds all occurrences of all patterns in a single pass over the text.
+ * Bytes are mapped to classes, one per byte appearing in the patterns and one shared by all the others,
+ * and the transitions are compiled into dense rows over the classes (one row per trie node),
+ * so matching takes one class lookup and one row load per text byte. */
+class AhoCorasick {
+public:
+    struct Match {
+        std::size_t pattern_id; // index of the pattern in the list it was built from
+        std::size_t offset; // offset of the first byte of the match in the text
+    };
+
+    /* Build the automaton from non-empty patterns. */
+    explicit AhoCorasick(const std::vector<std::string_view>& patterns);
+
+    /* Get the number of patterns. */
+    inline std::size_t size() const
+    {
+        return pattern_sizes.size();
+    }
+
+    /* Get the number of states (trie nodes) of the automaton. */
+    inline std::size_t nr_states() const
+    {
+        return first_report.size();
+    }
+
+    /* Scan the text and call on_match(pattern_id, offset) for every occurrence of every pattern,
+     * in the order of the occurrences' ends. */
+    template<typename OnMatch>
+    void scan(std::string_view text, OnMatch&& on_match) const
+    {
+        const std::uint32_t *const t = transitions.data();
+        std::uint32_t state = 0;
+        for (std::size_t i = 0; i < text.size(); ++i) {
+            state = t[state * nr_classes + byte_class[static_cast<unsigned char>(text[i])]];
+            for (std::uint32_t s = first_report[state]; s; s = next_report[s])
+                for (std::uint32_t k = first_output[s]; k < first_output[s + 1]; ++k)
+                    on_match(output_ids[k], i + 1 - pattern_sizes[output_ids[k]]);
+        }
+    }
+
+    /* Find all occurrences of all patterns. */
+    std::vector<Match> find_all(std::string_view text) const;
+
+    /* Count all occurrences of all patterns. */
+    std::size_t count(std::string_view text) const;
+
+private:
+    std::array<std::uint16_t, 256> byte_class {}; /* Class of each byte; 0 for bytes absent in the patterns. */
+    std::size_t nr_classes = 1; /* Number of byte classes, which is the row size. */
+    std::vector<std::uint32_t> transitions; /* Row-major dense transition table. */
+    std::vector<std::uint32_t> first_report; /* The state itself if patterns end in it, otherwise the nearest
+                                                such state along the failure links; 0 if there is none. */
+    std::vector<std::uint32_t> next_report; /* The nearest state along the failure links where patterns end. */
+    std::vector<std::uint32_t> first_output; /* Range of output_ids of each state (with a sentinel). */
+    std::vector<std::uint32_t> output_ids; /* Ids of the patterns ending in each state, grouped by state. */
+    std::vector<std::size_t> pattern_sizes; /* Size of each pattern. */
+};
@@ -0,0 +1,579 @@
+#pragma once
+
+/*
+ * Asymmetric numeral systems: normalized frequency model, rANS and tANS Encoders and Decoders
+ * */
+
+#include <cstddef>
+#include <cstdint>
+#include <bit>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <unordered_map>
+#include <istream>
+#include <ostream>
+
+#include "error.h"
+#include "bit_io.h"
+#include "huffman_coding.h"
+
+
+/* Class representing symbol frequencies normalized to sum up to 2^scale_bits.
+ * This is the probability model shared by the rANS and tANS coders. */
+template<typename Symbol>
+class AnsModel {
+public:
+    /* Construct the model from the provided symbol frequency map. */
+    explicit AnsModel(const std::unordered_map<Symbol, size_t>& sym_freq, unsigned scale_bits = 12)
+        : scale_bits(scale_bits)
+    {
+        if (scale_bits < 1 || scale_bits > 16)
+            throw Error<AnsModel>("Scale bits must be in range [1, 16]");
+        if (sym_freq.size() > (size_t(1) << scale_bits))
+            throw Error<AnsModel>("The alphabet is larger than the scale", scale_bits);
+
+        std::vector<std::pair<Symbol, size_t>> sorted_freq(sym_freq.begin(), sym_freq.end());
+        std::stable_sort(sorted_freq.begin(), sorted_freq.end(),
+                [](const auto& left, const auto& right) { return left.second > right.second; });
+
+        size_t total = 0;
+        for (const auto& [symbol, freq] : sorted_freq)
+            total += freq;
+
+        symbols.reserve(sorted_freq.size());
+        freqs.reserve(sorted_freq.size());
+        for (const auto& [symbol, freq] : sorted_freq) {
+            indices.emplace(symbol, static_cast<uint32_t>(symbols.size()));
+            symbols.push_back(symbol);
+            // every appearing symbol needs a non-zero probability to be encodable
+            freqs.push_back(std::max<uint32_t>(1, static_cast<uint32_t>(
+                            static_cast<double>(freq) * get_scale() / total)));
+        }
+        normalize();
+
+        cum_freqs.resize(freqs.size());
+        slot_to_index.resize(symbols.empty() ? 0 : get_scale());
+        uint32_t cum_freq = 0;
+        for (uint32_t i = 0; i < freqs.size(); ++i) {
+            cum_freqs[i] = cum_freq;
+            std::fill_n(slot_to_index.begin() + cum_freq, freqs[i], i);
+            cum_freq += freqs[i];
+        }
+    }
+
+    /* Construct the model for the provided stream of symbols. */
+    template<typename SymbolIt>
+    AnsModel(SymbolIt begin, SymbolIt end, unsigned scale_bits = 12)
+        : AnsModel(count_sym_freq(begin, end), scale_bits)
+    {}
+
+    /* Get the number of bits of precision of the normalized frequencies. */
+    inline unsigned get_scale_bits() const
+    {
+        return scale_bits;
+    }
+
+    /* Get the sum of all normalized frequencies (2^scale_bits). */
+    inline uint32_t get_scale() const
+    {
+        return uint32_t(1) << scale_bits;
+    }
+
+    /* Get the number of symbols in the alphabet. */
+    inline size_t size() const
+    {
+        return symbols.size();
+    }
+
+    /* Get the index of the symbol in the alphabet; throws if the symbol is not in the alphabet. */
+    uint32_t index_of(const Symbol& symbol) const
+    {
+        auto it = indices.find(symbol);
+        if (it == indices.end())
+            throw Error<AnsModel>("The symbol is not in the alphabet of the model");
+        return it->second;
+    }
+
+    /* Get the symbol by its index in the alphabet. */
+    inline const Symbol& get_symbol(uint32_t index) const
+    {
+        return symbols[index];
+    }
+
+    /* Get the normalized frequency of the symbol by its index. */
+    inline uint32_t get_freq(uint32_t index) const
+    {
+        return freqs[index];
+    }
+
+    /* Get the sum of normalized frequencies of all symbols preceding the symbol by its index. */
+    inline uint32_t get_cum_freq(uint32_t index) const
+    {
+        return cum_freqs[index];
+    }
+
+    /* Get the index of the symbol whose cumulative frequency range contains the slot. */
+    inline uint32_t get_slot_index(uint32_t slot) const
+    {
+        return slot_to_index[slot];
+    }
+
+private:
+    /* Make the rounded frequencies sum up to exactly 2^scale_bits.
+     * Symbols are sorted by frequency in descending order, so the error goes to the most frequent ones. */
+    void normalize()
+    {
+        if (freqs.empty())
+            return;
+
+        int64_t diff = get_scale();
+        for (uint32_t freq : freqs)
+            diff -= freq;
+
+        if (diff > 0)
+            freqs[0] += static_cast<uint32_t>(diff);
+        for (size_t i = 0; diff < 0; i = (i + 1) % freqs.size()) {
+            const auto taken = std::min<int64_t>(freqs[i] - 1, -diff);
+            freqs[i] -= static_cast<uint32_t>(taken);
+            diff += taken;
+        }
+    }
+
+    unsigned scale_bits; /* The number of bits of precision of the normalized frequencies. */
+    std::vector<Symbol> symbols; /* Symbols sorted by their frequency in descending order. */
+    std::vector<uint32_t> freqs; /* Normalized frequency of each symbol. */
+    std::vector<uint32_t> cum_freqs; /* Cumulative normalized frequency of each symbol. */
+    std::vector<uint32_t> slot_to_index; /* Maps each of the 2^scale_bits slots to its symbol index. */
+    std::unordered_map<Symbol, uint32_t> indices; /* Maps each symbol to its index. */
+};
+
+
+/* Interleaved rANS encoder class that deals with compression of the supplied data.
+ * As ANS decodes symbols in reverse order of encoding, the symbols are buffered and
+ * encoded as one block when finalizing. A block consists of the symbol count, two 32-bit states
+ * and the renormalization bytes, so multiple blocks may follow each other in the stream. */
+template<typename Symbol>
+class RansEncoder {
+public:
+    /* Construct rANS encoder from the model. */
+    RansEncoder(std::ostream& os, AnsModel<Symbol>&& model)
+        : os(os), model(std::move(model))
+    {}
+
+    /* Construct rANS encoder from the model. */
+    RansEncoder(std::ostream& os, const AnsModel<Symbol>& model)
+        : os(os), model(model)
+    {}
+
+    /* Construct rANS encoder with the model for the provided symbol stream. */
+    template<typename SymbolIt>
+    RansEncoder(std::ostream& os, SymbolIt begin, SymbolIt end)
+        : os(os), model(begin, end)
+    {}
+
+    ~RansEncoder()
+    {
+        finalize();
+    }
+
+    /* Buffer one symbol to be encoded. */
+    void put_sym(const Symbol& symbol)
+    {
+        indices.push_back(model.index_of(symbol));
+    }
+
+    /* Buffer symbol stream to be encoded. */
+    template<typename SymbolIt>
+    void write_syms(SymbolIt begin, SymbolIt end)
+    {
+        for (auto it = begin; it != end; ++it)
+            put_sym(*it);
+    }
+
+    /* Encode the buffered symbols as one block and write it to the output stream. */
+    void finalize()
+    {
+        if (indices.empty())
+            return;
+
+        std::vector<uint8_t> bytes; // filled backwards, written in reverse
+        uint32_t states[2] = {lower_bound, lower_bound};
+        for (size_t i = indices.size(); i-- > 0;) {
+            const uint32_t index = indices[i];
+            const uint32_t freq = model.get_freq(index);
+            uint32_t& state = states[i & 1];
+
+            const uint32_t state_max = ((lower_bound >> model.get_scale_bits()) << 8) * freq;
+            while (state >= state_max) {
+                bytes.push_back(static_cast<uint8_t>(state));
+                state >>= 8;
+            }
+            state = ((state / freq) << model.get_scale_bits()) + state % freq + model.get_cum_freq(index);
+        }
+        for (int k = 1; k >= 0; --k)
+            for (int i = 3; i >= 0; --i)
+                bytes.push_back(static_cast<uint8_t>(states[k] >> (8 * i)));
+
+        __write_le<uint64_t>(os, indices.size());
+        for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
+            os.put(static_cast<char>(*it));
+        indices.clear();
+    }
+
+    /* Lower bound of the normalized state interval. */
+    static constexpr uint32_t lower_bound = uint32_t(1) << 23;
+
+private:
+    std::ostream& os; /* The output stream where the encoded data is written to. */
+    AnsModel<Symbol> model; /* The probability model. */
+    std::vector<uint32_t> indices; /* Alphabet indices of the buffered symbols. */
+};
+
+
+/* Interleaved rANS decoder class that deals with decompression of the compressed data. */
+template<typename Symbol>
+class RansDecoder {
+public:
+    /* Construct rANS decoder from the model (the model must be alive throughout the lifetime of the decoder). */
+    RansDecoder(std::istream& is, const AnsModel<Symbol>& model)
+        : is(is), model(model)
+    {}
+
+    /* Read one symbol from the input stream. */
+    std::optional<Symbol> get_sym()
+    {
+        if (!nr_left && !start_block())
+            return std::nullopt;
+
+        uint32_t& state = states[nr_decoded++ & 1];
+        const uint32_t slot = state & (model.get_scale() - 1);
+        const uint32_t index = model.get_slot_index(slot);
+        state = model.get_freq(index) * (state >> model.get_scale_bits()) + slot - model.get_cum_freq(index);
+        while (state < RansEncoder<Symbol>::lower_bound)
+            state = (state << 8) | read_byte();
+        --nr_left;
+        return model.get_symbol(index);
+    }
+
+    /* Read multiple symbols from the input stream. */
+    template<typename SymbolIt>
+    void read_syms(SymbolIt begin, SymbolIt end)
+    {
+        for (auto it = begin; it != end; ++it) {
+            auto opt_symbol = get_sym();
+            if (!opt_symbol)
+                break;
+            *it = *opt_symbol;
+        }
+    }
+
+    /* Reset the decoder state. */
+    void reset()
+    {
+        nr_left = 0;
+    }
+
+private:
+    /* Read the header of the next block; false if the stream has ended. */
+    bool start_block()
+    {
+        auto opt_count = __read_le<uint64_t>(is);
+        if (!opt_count || !*opt_count)
+            return false;
+        nr_left = *opt_count;
+        nr_decoded = 0;
+        for (uint32_t& state : states) {
+            state = 0;
+            for (int i = 0; i < 4; ++i)
+                state |= uint32_t(read_byte()) << (8 * i);
+        }
+        return true;
+    }
+
+    uint8_t read_byte()
+    {
+        const auto c = is.get();
+        if (is.eof())
+            throw Error<RansDecoder>("Unexpected end of the rANS stream");
+        return static_cast<uint8_t>(c);
+    }
+
+    std::istream& is; /* The input stream from which the encoded data is read. */
+    const AnsModel<Symbol>& model; /* Reference to the probability model. */
+    uint32_t states[2] = {}; /* Interleaved rANS states. */
+    uint64_t nr_left = 0; /* Number of symbols left to decode in the current block. */
+    uint64_t nr_decoded = 0; /* Number of symbols decoded in the current block. */
+};
+
+
+/* Class representing the tANS (FSE-style) coding tables built from the model.
+ * The table has L = 2^scale_bits states; the encoder state lives in [L, 2L). */
+template<typename Symbol>
+class TansTable {
+public:
+    struct DecodeEntry {
+        uint32_t index; // alphabet index of the decoded symbol
+        uint32_t new_state_base; // next state before adding the read bits
+        uint8_t nr_bits; // number of bits to read
+    };
+
+    /* Construct tANS tables from the model. */
+    explicit TansTable(AnsModel<Symbol>&& model)
+        : model(std::move(model))
+    {
+        build();
+    }
+
+    /* Construct tANS tables from the model. */
+    explicit TansTable(const AnsModel<Symbol>& model)
+        : model(model)
+    {
+        build();
+    }
+
+    /* Construct tANS tables with the model for the provided symbol stream. */
+    template<typename SymbolIt>
+    TansTable(SymbolIt begin, SymbolIt end, unsigned table_log = 12)
+        : model(begin, end, table_log)
+    {
+        build();
+    }
+
+    inline const AnsModel<Symbol>& get_model() const
+    {
+        return model;
+    }
+
+    inline unsigned get_table_log() const
+    {
+        return model.get_scale_bits();
+    }
+
+    inline uint32_t get_table_size() const
+    {
+        return model.get_scale();
+    }
+
+    inline const DecodeEntry& get_decode_entry(uint32_t state) const
+    {
+        return decode_table[state];
+    }
+
+    /* Get the next encoder state for the state reduced to [freq, 2 * freq) of the symbol. */
+    inline uint32_t get_encode_state(uint32_t index, uint32_t reduced_state) const
+    {
+        return encode_table[model.get_cum_freq(index) + reduced_state - model.get_freq(index)];
+    }
+
+    /* Get the maximum number of bits output when encoding the symbol. */
+    inline unsigned get_max_nr_bits(uint32_t index) const
+    {
+        return get_table_log() + 1 - std::bit_width(model.get_freq(index));
+    }
+
+private:
+    void build()
+    {
+        if (get_table_log() < 4)
+            throw Error<TansTable>("Table log must be at least 4", get_table_log());
+
+        const uint32_t table_size = get_table_size();
+        const uint32_t mask = table_size - 1;
+        const uint32_t step = (table_size >> 1) + (table_size >> 3) + 3; // odd, so it visits every position
+
+        // spread the symbols across the table so that their occurrences are far from each other
+        std::vector<uint32_t> spread(table_size);
+        uint32_t pos = 0;
+        for (uint32_t index = 0; index < model.size(); ++index) {
+            for (uint32_t k = 0; k < model.get_freq(index); ++k) {
+                spread[pos] = index;
+                pos = (pos + step) & mask;
+            }
+        }
+
+        decode_table.resize(table_size);
+        encode_table.resize(table_size);
+        std::vector<uint32_t> next(model.size());
+        for (uint32_t index = 0; index < model.size(); ++index)
+            next[index] = model.get_freq(index);
+        for (uint32_t state = 0; state < table_size; ++state) {
+            const uint32_t index = spread[state];
+            const uint32_t reduced_state = next[index]++;
+            const uint8_t nr_bits = get_table_log() + 1 - std::bit_width(reduced_state);
+            decode_table[state] = {index, (reduced_state << nr_bits) - table_size, nr_bits};
+            encode_table[model.get_cum_freq(index) + reduced_state - model.get_freq(index)] = state + table_size;
+        }
+    }
+
+    AnsModel<Symbol> model; /* The probability model. */
+    std::vector<DecodeEntry> decode_table; /* Decoding transition of each state. */
+    std::vector<uint32_t> encode_table; /* Encoding transitions grouped by symbol. */
+};
+
+
+/* tANS encoder class that deals with compression of the supplied data.
+ * Like rANS, the symbols are buffered and encoded in reverse as one block when finalizing.
+ * A block consists of the symbol count, the final state, the number of padding bits
+ * and the bitstream, which is written so that the decoder reads it from the front. */
+template<typename Symbol>
+class TansEncoder {
+public:
+    /* Construct tANS encoder from the tables. */
+    TansEncoder(std::ostream& os, TansTable<Symbol>&& table)
+        : os(os), table(std::move(table))
+    {}
+
+    /* Construct tANS encoder from the tables. */
+    TansEncoder(std::ostream& os, const TansTable<Symbol>& table)
+        : os(os), table(table)
+    {}
+
+    /* Construct tANS encoder with the tables for the provided symbol stream. */
+    template<typename SymbolIt>
+    TansEncoder(std::ostream& os, SymbolIt begin, SymbolIt end)
+        : os(os), table(begin, end)
+    {}
+
+    ~TansEncoder()
+    {
+        finalize();
+    }
+
+    /* Buffer one symbol to be encoded. */
+    void put_sym(const Symbol& symbol)
+    {
+        indices.push_back(table.get_model().index_of(symbol));
+    }
+
+    /* Buffer symbol stream to be encoded. */
+    template<typename SymbolIt>
+    void write_syms(SymbolIt begin, SymbolIt end)
+    {
+        for (auto it = begin; it != end; ++it)
+            put_sym(*it);
+    }
+
+    /* Encode the buffered symbols as one block and write it to the output stream. */
+    void finalize()
+    {
+        if (indices.empty())
+            return;
+
+        const AnsModel<Symbol>& model = table.get_model();
+        // the bits are pushed LSB-first, so reading them backwards yields the chunks in decoding order
+        std::vector<uint8_t> bytes;
+        uint64_t acc = 0;
+        unsigned acc_bits = 0;
+        uint32_t state = table.get_table_size();
+        for (size_t i = indices.size(); i-- > 0;) {
+            const uint32_t index = indices[i];
+            const unsigned max_nr_bits = table.get_max_nr_bits(index);
+            const unsigned nr_bits = max_nr_bits - (state < (model.get_freq(index) << max_nr_bits));
+
+            acc |= uint64_t(state & ((uint32_t(1) << nr_bits) - 1)) << acc_bits;
+            acc_bits += nr_bits;
+            for (; acc_bits >= 8; acc_bits -= 8, acc >>= 8)
+                bytes.push_back(static_cast<uint8_t>(acc));
+
+            state = table.get_encode_state(index, state >> nr_bits);
+        }
+        if (acc_bits)
+            bytes.push_back(static_cast<uint8_t>(acc));
+
+        __write_le<uint64_t>(os, indices.size());
+        __write_le<uint32_t>(os, state - table.get_table_size());
+        os.put(static_cast<char>((8 - acc_bits) & 7));
+        for (auto it = bytes.rbegin(); it != bytes.rend(); ++it)
+            os.put(static_cast<char>(*it));
+        indices.clear();
+    }
+
+private:
+    std::ostream& os; /* The output stream where the encoded data is written to. */
+    TansTable<Symbol> table; /* The coding tables. */
+    std::vector<uint32_t> indices; /* Alphabet indices of the buffered symbols. */
+};
+
+
+/* tANS decoder class that deals with decompression of the compressed data. */
+template<typename Symbol>
+class TansDecoder {
+public:
+    /* Construct tANS decoder from the tables (the tables must be alive throughout the lifetime of the decoder). */
+    TansDecoder(std::istream& is, const TansTable<Symbol>& table)
+        : reader(is), table(table)
+    {}
+
+    /* Read one symbol from the input stream. */
+    std::optional<Symbol> get_sym()
+    {
+        if (!nr_left && !start_block())
+            return std::nullopt;
+
+        const auto& entry = table.get_decode_entry(state);
+        if (reader.available() < entry.nr_bits)
+            throw Error<TansDecoder>("Unexpected end of the tANS stream");
+        state = entry.new_state_base + static_cast<uint32_t>(reader.get(entry.nr_bits));
+        --nr_left;
+        return table.get_model().get_symbol(entry.index);
+    }
+
+    /* Read multiple symbols from the input stream. */
+    template<typename SymbolIt>
+    void read_syms(SymbolIt begin, SymbolIt end)
+    {
+        for (auto it = begin; it != end; ++it) {
+            auto opt_symbol = get_sym();
+            if (!opt_symbol)
+                break;
+            *it = *opt_symbol;
+        }
+    }
+
+    /* Reset the decoder state, discarding the bits read ahead from the stream. */
+    void reset()
+    {
+        nr_left = 0;
+        reader.reset();
+    }
+
+private:
+    /* Read the header of the next block through the bit reader, as it may have read ahead;
+     * false if the stream has ended. */
+    bool start_block()
+    {
+        if (!reader.available())
+            return false;
+        const uint64_t count = read_le(8);
+        const uint32_t final_state = static_cast<uint32_t>(read_le(4));
+        const unsigned padding = static_cast<unsigned>(read_le(1));
+        if (!count)
+            return false;
+        // the header is untrusted: the padding comes before the first code, so it is less than a byte
+        if (padding >= 8 || reader.available() < padding)
+            throw Error<TansDecoder>("Invalid padding in the tANS block header");
+        if (final_state >= table.get_table_size())
+            throw Error<TansDecoder>("Invalid final state in the tANS block header");
+        nr_left = count;
+        state = final_state;
+        reader.consume(padding);
+        return true;
+    }
+
+    uint64_t read_le(unsigned nr_bytes)
+    {
+        uint64_t value = 0;
+        for (unsigned i = 0; i < nr_bytes; ++i) {
+            if (reader.available() < 8)
+                throw Error<TansDecoder>("Unexpected end of the tANS stream");
+            value |= reader.get(8) << (8 * i);
+        }
+        return value;
+    }
+
+    BitReader reader; /* Bit reader over the input stream from which the encoded data is read. */
+    const TansTable<Symbol>& table; /* Reference to the coding tables. */
+    uint32_t state = 0; /* Current decoder state in [0, L). */
+    uint64_t nr_left = 0; /* Number of symbols left to decode in the current block. */
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+/*
+ * Bit-parallel approximate pattern matching: Bitap (Shift-And) for k mismatches
+ * and Myers' algorithm for edit distance, with multi-word bit vectors for long patterns
+ * */
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+
+/* Approximate match, identified by where it ends since its start is not unique under edit distance. */
+struct ApproximateMatch {
+    std::size_t end; /* Position after the last character of the match. */
+    unsigned errors; /* Smallest number of errors of a match ending there. */
+
+    bool operator==(const ApproximateMatch&) const = default;
+};
+
+
+/* Base of the compiled approximate patterns, which provides the searches in terms of the derived class's
+ * State and step(state, c, errors), the latter reporting whether a match ends at the character just read. */
+template<typename Pattern>
+class __ApproximatePatternBase {
+public:
+    /* Find the first match. */
+    std::optional<ApproximateMatch> find(std::string_view str) const
+    {
+        std::optional<ApproximateMatch> match;
+        scan(str, [&match](const ApproximateMatch& m) { match = m; return false; });
+        return match;
+    }
+
+    /* Find all the positions where matches end. */
+    std::vector<ApproximateMatch> find_all(std::string_view str) const
+    {
+        std::vector<ApproximateMatch> matches;
+        scan(str, [&matches](const ApproximateMatch& m) { matches.push_back(m); return true; });
+        return matches;
+    }
+
+    /* Count the positions where matches end. */
+    std::size_t count(std::string_view str) const
+    {
+        std::size_t nr_matches = 0;
+        scan(str, [&nr_matches](const ApproximateMatch&) { ++nr_matches; return true; });
+        return nr_matches;
+    }
+
+private:
+    /* Call on_match for each match until it returns false. */
+    template<typename OnMatch>
+    void scan(std::string_view str, OnMatch&& on_match) const
+    {
+        const Pattern& pattern = static_cast<const Pattern&>(*this);
+        typename Pattern::State state = pattern.initial_state();
+        unsigned errors;
+        for (std::size_t i = 0; i < str.size(); ++i)
+            if (pattern.step(state, str[i], errors) && !on_match(ApproximateMatch {i + 1, errors}))
+                return;
+    }
+};
+
+
+/* Pattern compiled for matching with at most max_errors mismatched characters (Hamming distance),
+ * using the Bitap (Shift-And) algorithm: bit i of the d-th bit vector tells if the pattern's prefix
+ * of length i + 1 matches the text ending at the current character with at most d mismatches.
+ * Each character costs O((max_errors + 1) * ceil(m / 64)) word operations. */
+class BitapPattern : public __ApproximatePatternBase<BitapPattern> {
+public:
+    /* The bit vectors of all the error levels, each of nr_words words. */
+    using State = std::vector<std::uint64_t>;
+
+    /* Compile the pattern; max_errors must be less than its size. */
+    BitapPattern(std::string_view pattern, unsigned max_errors);
+
+    inline std::size_t size() const
+    {
+        return pattern_size;
+    }
+
+    inline unsigned get_max_errors() const
+    {
+        return max_errors;
+    }
+
+    inline State initial_state() const
+    {
+        return State((max_errors + 1) * nr_words, 0);
+    }
+
+    /* Advance the state by the character; if a match ends at it, return true and set its number of errors.
+     * The match starts size() - 1 characters before. */
+    inline bool step(State& state, char c, unsigned& errors) const
+    {
+        const std::uint64_t *const eq = masks.data() + static_cast<unsigned char>(c) * nr_words;
+        // higher error levels go first, since they are updated from the old lower ones
+        for (std::size_t d = max_errors + 1; d-- > 0;) {
+            std::uint64_t *const r = state.data() + d * nr_words;
+            const std::uint64_t *const r_prev = r - nr_words;
+            std::uint64_t carry = 1, carry_prev = 1;
+            for (std::size_t w = 0; w < nr_words; ++w) {
+                const std::uint64_t curr = r[w];
+                std::uint64_t next = ((curr << 1) | carry) & eq[w];
+                carry = curr >> 63;
+                if (d > 0) {
+                    next |= (r_prev[w] << 1) | carry_prev;
+                    carry_prev = r_prev[w] >> 63;
+                }
+                r[w] = next;
+            }
+        }
+        for (unsigned d = 0; d <= max_errors; ++d) {
+            if (state[d * nr_words + nr_words - 1] & last_bit) {
+                errors = d;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    std::size_t pattern_size;
+    unsigned max_errors;
+    std::size_t nr_words; /* Number of 64-bit words per bit vector. */
+    std::uint64_t last_bit; /* Bit of the last pattern character in the last word. */
+    std::vector<std::uint64_t> masks; /* For each byte, the bit vector of its positions in the pattern. */
+};
+
+
+/* Pattern compiled for matching with at most max_errors insertions, deletions and substitutions
+ * (edit distance), using Myers' bit-vector algorithm: the column of the dynamic programming matrix
+ * is kept as vertical positive and negative delta bit vectors, which are advanced a word at a time,
+ * with the horizontal delta carried between the words. Each character costs O(ceil(m / 64)) word operations. */
+class MyersPattern : public __ApproximatePatternBase<MyersPattern> {
+public:
+    struct State {
+        std::vector<std::uint64_t> pv, mv; /* Vertical positive and negative deltas. */
+        std::size_t score; /* Edit distance of the whole pattern to the best substring ending here. */
+    };
+
+    /* Compile the pattern; max_errors must be less than its size. */
+    MyersPattern(std::string_view pattern, unsigned max_errors);
+
+    inline std::size_t size() const
+    {
+        return pattern_size;
+    }
+
+    inline unsigned get_max_errors() const
+    {
+        return max_errors;
+    }
+
+    inline State initial_state() const
+    {
+        return {std::vector<std::uint64_t>(nr_words, ~std::uint64_t(0)), std::vector<std::uint64_t>(nr_words, 0),
+            pattern_size};
+    }
+
+    /* Advance the state by the character; if a match ends at it, return true and set its number of errors. */
+    inline bool step(State& state, char c, unsigned& errors) const
+    {
+        const std::uint64_t *const peq = masks.data() + static_cast<unsigned char>(c) * nr_words;
+        int h_in = 0; // the first row is all zeros: a match may start anywhere
+        for (std::size_t w = 0; w < nr_words; ++w) {
+            const std::uint64_t pv = state.pv[w], mv = state.mv[w];
+            std::uint64_t eq = peq[w];
+            const std::uint64_t xv = eq | mv;
+            if (h_in < 0)
+                eq |= 1;
+            const std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            std::uint64_t ph = mv | ~(xh | pv);
+            std::uint64_t mh = pv & xh;
+
+            const std::uint64_t high = w + 1 < nr_words ? std::uint64_t(1) << 63 : last_bit;
+            const int h_out = (ph & high) ? 1 : (mh & high) ? -1 : 0;
+            ph <<= 1;
+            mh <<= 1;
+            if (h_in < 0)
+                mh |= 1;
+            else if (h_in > 0)
+                ph |= 1;
+            state.pv[w] = mh | ~(xv | ph);
+            state.mv[w] = ph & xv;
+            h_in = h_out;
+        }
+        state.score += h_in;
+        if (state.score > max_errors)
+            return false;
+        errors = static_cast<unsigned>(state.score);
+        return true;
+    }
+
+private:
+    std::size_t pattern_size;
+    unsigned max_errors;
+    std::size_t nr_words; /* Number of 64-bit words per bit vector. */
+    std::uint64_t last_bit; /* Bit of the last pattern character in the last word. */
+    std::vector<std::uint64_t> masks; /* For each byte, the bit vector of its positions in the pattern. */
+};
+
+
+/* Stateful approximate matcher for data arriving in chunks, the counterpart of KmpStreamMatcher:
+ * the bit vectors are kept between the chunks, so matches straddling chunk boundaries are found
+ * without buffering the input. Matches are reported by their absolute end offsets in the whole stream. */
+template<typename Pattern>
+class ApproximateStreamMatcher {
+public:
+    explicit ApproximateStreamMatcher(Pattern pattern)
+        : pattern(std::move(pattern)), state(this->pattern.initial_state())
+    {}
+
+    /* Feed the next chunk and call on_match(match) for every match ending in it. */
+    template<typename OnMatch>
+    void feed(std::span<const char> chunk, OnMatch&& on_match)
+    {
+        unsigned errors;
+        for (std::size_t i = 0; i < chunk.size(); ++i)
+            if (pattern.step(state, chunk[i], errors))
+                on_match(ApproximateMatch {offset + i + 1, errors});
+        offset += chunk.size();
+    }
+
+    /* Feed the next chunk and get the matches ending in it. */
+    std::vector<ApproximateMatch> feed(std::span<const char> chunk)
+    {
+        std::vector<ApproximateMatch> matches;
+        feed(chunk, [&matches](const ApproximateMatch& match) { matches.push_back(match); });
+        return matches;
+    }
+
+    /* Get the number of bytes fed so far. */
+    inline std::size_t position() const
+    {
+        return offset;
+    }
+
+    /* Start a new stream. */
+    inline void reset()
+    {
+        state = pattern.initial_state();
+        offset = 0;
+    }
+
+private:
+    Pattern pattern;
+    typename Pattern::State state;
+    std::size_t offset = 0; /* Number of bytes fed so far. */
+};
@@ -0,0 +1,151 @@
+#pragma once
+
+/*
+ * Bit I/O: MSB-first bit writer and bit reader over byte streams
+ * */
+
+#include <cassert>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <streambuf>
+
+#if defined(__BMI2__)
+#include <immintrin.h>
+#endif
+
+
+/* Get the lowest nr_bits bits of the value (nr_bits < 64). */
+inline uint64_t low_bits(uint64_t value, unsigned nr_bits)
+{
+#if defined(__BMI2__)
+    return _bzhi_u64(value, nr_bits);
+#else
+    return value & ((uint64_t(1) << nr_bits) - 1);
+#endif
+}
+
+
+/* Class that packs bit sequences MSB-first into bytes and writes them to the output stream.
+ * Bits are accumulated in a 64-bit word and written out several bytes at a time. */
+class BitWriter {
+public:
+    /* The maximum number of bits that can be put at once. */
+    static constexpr unsigned max_put_bits = 57;
+
+    explicit BitWriter(std::ostream& os) : os(os)
+    {}
+
+    ~BitWriter()
+    {
+        flush();
+    }
+
+    /* Write the lowest nr_bits bits of the value, the most significant one first (nr_bits <= max_put_bits). */
+    inline void put(uint64_t bits, unsigned nr_bits)
+    {
+        if (nr_acc_bits + nr_bits > 64)
+            flush_bytes();
+        acc = (acc << nr_bits) | low_bits(bits, nr_bits);
+        nr_acc_bits += nr_bits;
+    }
+
+    /* Write all pending bits followed by zero bits up to the byte boundary. */
+    void flush()
+    {
+        flush_bytes();
+        if (nr_acc_bits) {
+            os.put(static_cast<char>(acc << (8 - nr_acc_bits)));
+            nr_acc_bits = 0;
+        }
+    }
+
+private:
+    /* Write all complete bytes of the accumulator; less than 8 bits are left pending. */
+    void flush_bytes()
+    {
+        char bytes[8];
+        const unsigned nr_bytes = nr_acc_bits / 8;
+        for (unsigned i = 0; i < nr_bytes; ++i)
+            bytes[i] = static_cast<char>(acc >> (nr_acc_bits - 8 * (i + 1)));
+        os.write(bytes, nr_bytes);
+        nr_acc_bits -= 8 * nr_bytes;
+    }
+
+    std::ostream& os; /* The output stream where the bits are written to. */
+    uint64_t acc = 0; /* Pending bits, right-aligned; bits above nr_acc_bits are stale. */
+    unsigned nr_acc_bits = 0; /* Number of pending bits. */
+};
+
+
+/* Class that reads bits MSB-first from the input stream.
+ * Up to 8 bytes are read ahead into a 64-bit word, so peeking and consuming bits
+ * does not touch the stream most of the time and involves no per-bit branches. */
+class BitReader {
+public:
+    /* The maximum number of bits that can be peeked at once. */
+    static constexpr unsigned max_peek_bits = 57;
+
+    explicit BitReader(std::istream& is) : is(is)
+    {}
+
+    /* Get the next nr_bits bits without consuming them (nr_bits <= max_peek_bits).
+     * Bits past the end of the stream read as zero. */
+    inline uint64_t peek(unsigned nr_bits)
+    {
+        if (nr_bits > nr_buf_bits)
+            refill();
+        return (buf >> 1) >> (63 - nr_bits);
+    }
+
+    /* Consume nr_bits bits previously peeked; they must be available. */
+    inline void consume(unsigned nr_bits)
+    {
+        assert(nr_bits <= nr_buf_bits);
+        buf <<= nr_bits;
+        nr_buf_bits -= nr_bits;
+    }
+
+    /* Read and consume nr_bits bits (nr_bits <= max_peek_bits). */
+    inline uint64_t get(unsigned nr_bits)
+    {
+        const uint64_t bits = peek(nr_bits);
+        consume(nr_bits);
+        return bits;
+    }
+
+    /* Get the number of bits that can be read before the end of the stream, up to max_peek_bits. */
+    inline unsigned available()
+    {
+        if (nr_buf_bits < max_peek_bits)
+            refill();
+        return nr_buf_bits < max_peek_bits ? nr_buf_bits : max_peek_bits;
+    }
+
+    /* Discard the bits read ahead from the stream. */
+    void reset()
+    {
+        buf = 0;
+        nr_buf_bits = 0;
+    }
+
+private:
+    /* Read bytes from the stream until the buffer holds at least max_peek_bits bits or the stream ends. */
+    void refill()
+    {
+        std::streambuf *const sb = is.rdbuf();
+        while (nr_buf_bits <= 56) {
+            const auto c = sb->sbumpc();
+            if (c == std::streambuf::traits_type::eof()) {
+                is.setstate(std::ios_base::eofbit);
+                break;
+            }
+            buf |= uint64_t(static_cast<unsigned char>(c)) << (56 - nr_buf_bits);
+            nr_buf_bits += 8;
+        }
+    }
+
+    std::istream& is; /* The input stream from which the bits are read. */
+    uint64_t buf = 0; /* Unread bits, left-aligned; bits below nr_buf_bits are zero. */
+    unsigned nr_buf_bits = 0; /* Number of unread bits. */
+};
@@ -0,0 +1,55 @@
+#pragma once
+
+/*
+ * Parallel connected components of undirected graphs, over the concurrent union-find
+ * */
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+
+/* Undirected edge between two vertices. */
+struct GraphEdge {
+    std::uint32_t u, v;
+};
+
+/* Graph in compressed sparse row form: the neighbors of the vertex v are neighbors[offsets[v]..offsets[v + 1]). */
+struct CsrGraph {
+    std::vector<std::size_t> offsets;
+    std::vector<std::uint32_t> neighbors;
+
+    inline std::size_t nr_vertices() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+};
+
+/* Connected components of a graph. */
+struct ConnectedComponents {
+    std::vector<std::uint32_t> labels; /* Component of each vertex, in [0, count); the components are numbered
+                                          in the order of their smallest vertices, whatever the number of threads. */
+    std::size_t count = 0;
+};
+
+/* Build the symmetric adjacency of the edges: each edge is stored at both of its ends. The order of the neighbors
+ * of a vertex is the order of the edges on one thread and unspecified on more. nr_threads = 0 means
+ * the hardware concurrency. */
+CsrGraph build_csr(std::span<const GraphEdge> edges, std::size_t nr_vertices, unsigned nr_threads = 0);
+
+/* Find the connected components of a graph given by its edges; nr_threads = 0 means the hardware concurrency.
+ * The edges are split across the threads, which merge them in a ConcurrentUnionFind, and sampling after Afforest
+ * skips most of the edges of the giant component: a strided sample of about two edges per vertex is merged first,
+ * the forest is flattened, and the vertices of the most frequent root among a sample of the vertices are marked
+ * in a bitmap. The remaining edges with both ends marked are then skipped by testing two bits, which stay
+ * in the cache far longer than the parent links, and an edge with one end marked is merged from the giant root.
+ * The adjacency is not needed, as building it costs more than the merges themselves. */
+ConnectedComponents connected_components(std::span<const GraphEdge> edges, std::size_t nr_vertices,
+        unsigned nr_threads = 0);
+
+/* Find the connected components of a symmetric graph with the Afforest algorithm (Sutton et al.): the vertices
+ * are linked to their first two neighbors, the forest is flattened, and the rest of the neighbors is then merged
+ * only for the vertices outside the giant component found by sampling. Skipping the vertices of the giant
+ * component is only correct if every edge is stored at both of its ends, as build_csr does. */
+ConnectedComponents connected_components(const CsrGraph& graph, unsigned nr_threads = 0);
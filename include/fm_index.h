@@ -0,0 +1,132 @@
+#pragma once
+
+/*
+ * FM-index: compressed full-text index built on the Burrows-Wheeler transform
+ * and a Huffman-shaped wavelet tree
+ * */
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "huffman_coding.h"
+
+
+/* Bit vector with constant-time rank: the number of ones before each block of 512 bits is stored,
+ * and the ones within the block are counted with popcount, costing 12.5% of extra space. */
+class RankBitVector {
+public:
+    RankBitVector() = default;
+
+    explicit RankBitVector(std::size_t size) : nr_bits(size), words((size + 63) / 64, 0)
+    {}
+
+    inline std::size_t size() const
+    {
+        return nr_bits;
+    }
+
+    /* Set the bit; all the bits must be set before build_rank() is called. */
+    inline void set(std::size_t i)
+    {
+        words[i / 64] |= std::uint64_t(1) << (i % 64);
+    }
+
+    inline bool operator[](std::size_t i) const
+    {
+        return (words[i / 64] >> (i % 64)) & 1;
+    }
+
+    /* Build the rank directory. */
+    void build_rank();
+
+    /* Get the number of ones before the position. */
+    inline std::size_t rank1(std::size_t i) const
+    {
+        const std::size_t word = i / 64, block = word / words_per_block;
+        std::size_t rank = block_ranks[block];
+        for (std::size_t w = block * words_per_block; w < word; ++w)
+            rank += std::popcount(words[w]);
+        if (i % 64)
+            rank += std::popcount(words[word] << (64 - i % 64));
+        return rank;
+    }
+
+    /* Get the memory used in bytes. */
+    inline std::size_t memory_usage() const
+    {
+        return (words.capacity() + block_ranks.capacity()) * sizeof(std::uint64_t);
+    }
+
+private:
+    static constexpr std::size_t words_per_block = 8;
+
+    std::size_t nr_bits = 0;
+    std::vector<std::uint64_t> words;
+    std::vector<std::uint64_t> block_ranks; /* Number of ones before each block. */
+};
+
+
+/* FM-index of a text: the Burrows-Wheeler transform of the text, stored in a wavelet tree shaped
+ * as the text's Huffman tree (built with build_huffman_tree), so that it takes about n * H0 bits
+ * and a rank query takes one bit vector rank per bit of the symbol's codeword, plus a suffix array
+ * sampled at every sample_rate-th text position.
+ * count takes O(m * H0) time and locate O((m + occ * sample_rate) * H0), neither depending on the text size. */
+class FmIndex {
+public:
+    explicit FmIndex(std::string_view text, std::size_t sample_rate = 32);
+
+    /* Get the size of the indexed text. */
+    inline std::size_t size() const
+    {
+        return text_size;
+    }
+
+    /* Count the occurrences of the pattern. */
+    std::size_t count(std::string_view pat) const;
+
+    /* Get the positions of all occurrences of the pattern in increasing order. */
+    std::vector<std::size_t> locate(std::string_view pat) const;
+
+    /* Get the memory used by the index in bytes. */
+    std::size_t memory_usage() const;
+
+private:
+    /* Wavelet tree node; children are node indices, or leaves encoded as -1 - symbol. */
+    struct Node {
+        RankBitVector bits;
+        std::array<std::int32_t, 2> children;
+    };
+
+    /* Build the subtree of the wavelet tree for the Huffman subtree at the depth, over the sequence. */
+    std::int32_t build_node(const HuffmanTree<char> *tree, unsigned depth, std::vector<char>&& seq);
+
+    /* Get the number of occurrences of the symbol in the BWT before the row. */
+    std::size_t occ(unsigned char c, std::size_t row) const;
+
+    /* Get the BWT symbol at the row, which must not be the row of the sentinel. */
+    unsigned char symbol_at(std::size_t row) const;
+
+    /* Get the row of the previous text position (the LF mapping). */
+    std::size_t lf(std::size_t row) const;
+
+    /* Get the sample with the index. */
+    std::size_t get_sample(std::size_t i) const;
+
+    /* Get the range of rows whose suffixes start with the pattern. */
+    std::pair<std::size_t, std::size_t> find_rows(std::string_view pat) const;
+
+    std::size_t text_size = 0;
+    std::size_t sentinel_row = 0; /* Row of the BWT holding the sentinel, which the wavelet tree skips. */
+    std::array<std::size_t, 257> first_row {}; /* Row of the first suffix starting with each symbol. */
+    std::vector<Node> nodes; /* Wavelet tree, the root first. */
+    std::int32_t root = -1; /* Root of the wavelet tree, a leaf if the text has a single distinct symbol. */
+    HuffmanCodebook<char> codebook; /* Path of each symbol in the wavelet tree. */
+    std::size_t sample_rate;
+    RankBitVector sampled; /* Rows whose text positions are sampled. */
+    unsigned sample_width = 0; /* Number of bits per sample. */
+    std::vector<std::uint64_t> samples; /* Text positions of the sampled rows in row order, bit-packed. */
+};
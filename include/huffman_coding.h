@@ -5,15 +5,27 @@
  * */
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <array>
+#include <limits>
+#include <type_traits>
 #include <variant>
 #include <optional>
 #include <memory>
+#include <string>
+#include <vector>
 #include <unordered_map>
 #include <queue>
 #include <istream>
 #include <ostream>
+#include <sstream>
+#include <algorithm>
+#include <iterator>
 
 #include "error.h"
+#include "bit_io.h"
 
 
 /* Class representing the Huffman tree. */
@@ -84,15 +96,90 @@ template<typename Symbol>
 std::unique_ptr<HuffmanTree<Symbol>> build_huffman_tree(const std::unordered_map<Symbol, size_t>& sym_freq);
 
 
-/* Build an optimal Huffman tree for the provided stream of symbols. */
+/* Write an unsigned integer in little-endian byte order. */
+template<std::unsigned_integral UInt>
+void __write_le(std::ostream& os, UInt value)
+{
+    for (size_t i = 0; i < sizeof(UInt); ++i)
+        os.put(static_cast<char>(value >> (8 * i)));
+}
+
+
+/* Read an unsigned integer in little-endian byte order; nothing if the stream has ended. */
+template<std::unsigned_integral UInt>
+std::optional<UInt> __read_le(std::istream& is)
+{
+    UInt value = 0;
+    for (size_t i = 0; i < sizeof(UInt); ++i) {
+        const auto c = is.get();
+        if (is.eof())
+            return std::nullopt;
+        value |= static_cast<UInt>(static_cast<unsigned char>(c)) << (8 * i);
+    }
+    return value;
+}
+
+
+/* Measure the frequency of each symbol appearing in the provided stream of symbols. */
 template<typename SymbolIt>
-std::unique_ptr<HuffmanTree<std::iter_value_t<SymbolIt>>> build_huffman_tree(SymbolIt begin, SymbolIt end)
+std::unordered_map<std::iter_value_t<SymbolIt>, size_t> count_sym_freq(SymbolIt begin, SymbolIt end)
 {
     using Symbol = std::iter_value_t<SymbolIt>;
     std::unordered_map<Symbol, size_t> sym_freq;
-    for (auto it = begin; it != end; ++it)
-        ++sym_freq[*it]; // measure the frequency of each appearing symbol
-    return build_huffman_tree(sym_freq);
+    if constexpr (std::is_integral_v<Symbol> && sizeof(Symbol) == 1) {
+        // single byte symbols are counted in a flat array, which is an order of magnitude faster
+        std::array<size_t, 256> byte_freq {};
+        for (auto it = begin; it != end; ++it)
+            ++byte_freq[static_cast<unsigned char>(*it)];
+        for (size_t i = 0; i < byte_freq.size(); ++i)
+            if (byte_freq[i])
+                sym_freq[static_cast<Symbol>(i)] = byte_freq[i];
+    } else {
+        for (auto it = begin; it != end; ++it)
+            ++sym_freq[*it];
+    }
+    return sym_freq;
+}
+
+
+/* Estimate the Shannon entropy of the symbol distribution in bits per symbol. */
+template<typename Symbol>
+double estimate_entropy(const std::unordered_map<Symbol, size_t>& sym_freq)
+{
+    size_t total = 0;
+    for (const auto& [symbol, freq] : sym_freq)
+        total += freq;
+    if (!total)
+        return 0;
+
+    double entropy = 0;
+    for (const auto& [symbol, freq] : sym_freq) {
+        if (!freq)
+            continue;
+        const double p = static_cast<double>(freq) / total;
+        entropy -= p * std::log2(p);
+    }
+    return entropy;
+}
+
+
+/* Estimate the size in bytes of the symbols Huffman encoded: the entropy bound rounded up to bytes.
+ * Huffman codes never get below the entropy, so the estimate is a lower bound. */
+template<typename Symbol>
+size_t estimate_encoded_size(const std::unordered_map<Symbol, size_t>& sym_freq)
+{
+    size_t total = 0;
+    for (const auto& [symbol, freq] : sym_freq)
+        total += freq;
+    return static_cast<size_t>(std::ceil(estimate_entropy(sym_freq) * total / 8));
+}
+
+
+/* Build an optimal Huffman tree for the provided stream of symbols. */
+template<typename SymbolIt>
+std::unique_ptr<HuffmanTree<std::iter_value_t<SymbolIt>>> build_huffman_tree(SymbolIt begin, SymbolIt end)
+{
+    return build_huffman_tree(count_sym_freq(begin, end));
 }
 
 
@@ -170,33 +257,202 @@ void __build_huffman_table(const HuffmanTree<Symbol> *tree, HuffmanTable<Symbol>
 }
 
 
+/* Codeword packed into an integer: the lowest `length` bits of `bits`, the most significant bit first. */
+struct HuffmanCodeword {
+    uint64_t bits;
+    unsigned length;
+};
+
+
+/* Type representing Huffman codebook that maps each symbol to its packed codeword, as used by the encoder. */
+template<typename Symbol>
+using HuffmanCodebook = std::unordered_map<Symbol, HuffmanCodeword>;
+
+
+/* Build Huffman codebook by packing each codeword of the table. */
+template<typename Symbol>
+HuffmanCodebook<Symbol> build_huffman_codebook(const HuffmanTable<Symbol>& table)
+{
+    HuffmanCodebook<Symbol> codebook;
+    for (const auto& [symbol, codeword] : table) {
+        if (codeword.size() > BitWriter::max_put_bits)
+            throw Error<HuffmanCodebook<Symbol>>("The Huffman codeword is too long to be packed", codeword.size());
+        HuffmanCodeword& packed = codebook[symbol];
+        packed = {0, static_cast<unsigned>(codeword.size())};
+        for (char c : codeword)
+            packed.bits = (packed.bits << 1) | (c != '0');
+    }
+    return codebook;
+}
+
+
+/* Class representing a pre-trained Huffman dictionary: a tree and its codeword table that are built once
+ * and shared read-only by any number of encoders and decoders (including ones used by different threads),
+ * so that compressing small messages costs neither a tree build nor a header per message. */
+template<typename Symbol>
+class HuffmanDictionary {
+public:
+    /* Construct the dictionary from the tree. */
+    explicit HuffmanDictionary(std::unique_ptr<HuffmanTree<Symbol>>&& tree)
+        : tree(std::move(tree))
+    {
+        if (!this->tree)
+            throw Error<HuffmanDictionary>("A Huffman dictionary must have a tree");
+        table = std::make_shared<const HuffmanTable<Symbol>>(build_huffman_table(this->tree.get()));
+        codebook = std::make_shared<const HuffmanCodebook<Symbol>>(build_huffman_codebook(*table));
+    }
+
+    /* Train the dictionary on the sample corpus, a range of symbol sequences (e.g. strings).
+     * For single byte integral symbols, every possible symbol gets a codeword,
+     * so that messages containing symbols absent in the corpus can still be encoded. */
+    template<typename SampleIt>
+    static HuffmanDictionary train(SampleIt begin, SampleIt end)
+    {
+        std::unordered_map<Symbol, size_t> sym_freq;
+        if constexpr (std::is_integral_v<Symbol> && sizeof(Symbol) == 1) {
+            for (int i = std::numeric_limits<Symbol>::min(); i <= std::numeric_limits<Symbol>::max(); ++i)
+                sym_freq[static_cast<Symbol>(i)] = 1;
+        }
+        for (auto it = begin; it != end; ++it)
+            for (const auto& symbol : *it)
+                ++sym_freq[symbol];
+        return HuffmanDictionary(build_huffman_tree(sym_freq));
+    }
+
+    /* Load the dictionary previously saved with save(). */
+    static HuffmanDictionary load(std::istream& is)
+    {
+        static_assert(std::is_trivially_copyable_v<Symbol>, "Only trivially copyable symbols can be loaded");
+
+        char magic[sizeof(file_magic)] {};
+        is.read(magic, sizeof(magic));
+        if (!is || std::char_traits<char>::compare(magic, file_magic, sizeof(magic)) != 0)
+            throw Error<HuffmanDictionary>("Not a Huffman dictionary");
+        if (is.get() != sizeof(Symbol))
+            throw Error<HuffmanDictionary>("Mismatching symbol size of the Huffman dictionary");
+        return HuffmanDictionary(load_tree(is));
+    }
+
+    /* Save the dictionary: the tree is written in pre-order,
+     * a non-leaf node as a zero byte, a leaf node as a non-zero byte followed by the symbol bytes. */
+    void save(std::ostream& os) const
+    {
+        static_assert(std::is_trivially_copyable_v<Symbol>, "Only trivially copyable symbols can be saved");
+
+        os.write(file_magic, sizeof(file_magic));
+        os.put(static_cast<char>(sizeof(Symbol)));
+        save_tree(os, tree.get());
+    }
+
+    /* Get the Huffman tree. */
+    inline const HuffmanTree<Symbol>& get_tree() const
+    {
+        return *tree;
+    }
+
+    /* Get the shared Huffman table. */
+    inline const std::shared_ptr<const HuffmanTable<Symbol>>& get_table() const
+    {
+        return table;
+    }
+
+    /* Get the shared Huffman codebook. */
+    inline const std::shared_ptr<const HuffmanCodebook<Symbol>>& get_codebook() const
+    {
+        return codebook;
+    }
+
+private:
+    /* Load the tree saved in pre-order, iteratively, as the input is untrusted: the stack holds the open non-leaf
+     * nodes, each with its left subtree once it is complete. A tree deeper than the longest codeword that can be
+     * packed, or with more nodes than a full tree over all the symbols, is rejected, which also bounds
+     * the recursion of destroying the nodes. */
+    static std::unique_ptr<HuffmanTree<Symbol>> load_tree(std::istream& is)
+    {
+        constexpr size_t max_nr_leaves = sizeof(Symbol) < sizeof(size_t) / 2 ? size_t(1) << (8 * sizeof(Symbol))
+                                                                              : std::numeric_limits<size_t>::max() / 2;
+        std::vector<std::unique_ptr<HuffmanTree<Symbol>>> open_nodes;
+        for (size_t nr_nodes = 1;; ++nr_nodes) {
+            if (nr_nodes > 2 * max_nr_leaves - 1)
+                throw Error<HuffmanDictionary>("Too many nodes in the Huffman dictionary");
+            if (open_nodes.size() > BitWriter::max_put_bits)
+                throw Error<HuffmanDictionary>("The Huffman dictionary tree is too deep");
+            const auto tag = is.get();
+            if (is.eof())
+                throw Error<HuffmanDictionary>("Unexpected end of the Huffman dictionary");
+            if (!tag) {
+                open_nodes.emplace_back();
+                continue;
+            }
+
+            Symbol symbol;
+            is.read(reinterpret_cast<char *>(&symbol), sizeof(Symbol));
+            if (!is)
+                throw Error<HuffmanDictionary>("Unexpected end of the Huffman dictionary");
+            auto node = std::make_unique<HuffmanTree<Symbol>>(0, symbol);
+            // a complete subtree is the left one of the innermost open node, or completes it as its right one
+            for (;;) {
+                if (open_nodes.empty())
+                    return node;
+                if (!open_nodes.back()) {
+                    open_nodes.back() = std::move(node);
+                    break;
+                }
+                node = std::make_unique<HuffmanTree<Symbol>>(std::move(open_nodes.back()), std::move(node));
+                open_nodes.pop_back();
+            }
+        }
+    }
+
+    static void save_tree(std::ostream& os, const HuffmanTree<Symbol> *tree)
+    {
+        auto opt_symbol = tree->get_symbol();
+        os.put(opt_symbol.has_value());
+        if (opt_symbol) {
+            os.write(reinterpret_cast<const char *>(&*opt_symbol), sizeof(Symbol));
+            return;
+        }
+        save_tree(os, tree->get_left());
+        save_tree(os, tree->get_right());
+    }
+
+    static constexpr char file_magic[4] = {'H', 'U', 'F', 'D'};
+
+    std::shared_ptr<const HuffmanTree<Symbol>> tree; /* The Huffman tree shared by decoders. */
+    std::shared_ptr<const HuffmanTable<Symbol>> table; /* The Huffman table. */
+    std::shared_ptr<const HuffmanCodebook<Symbol>> codebook; /* The Huffman codebook shared by encoders. */
+};
+
+
 /* Huffman encoder class that deals with compression of the supplied data. */
 template<typename Symbol>
 class HuffmanEncoder {
 public:
     /* Construct Huffman encoder from the table. */
     HuffmanEncoder(std::ostream& os, HuffmanTable<Symbol>&& table)
-        : os(os), table(std::move(table))
+        : writer(os), codebook(std::make_shared<const HuffmanCodebook<Symbol>>(build_huffman_codebook(table)))
     {}
 
     /* Construct Huffman encoder from the tree. */
     HuffmanEncoder(std::ostream& os, const std::unique_ptr<HuffmanTree<Symbol>> &tree)
-        : os(os), table(build_huffman_table(tree.get()))
+        : HuffmanEncoder(os, tree.get())
     {}
 
     /* Construct Huffman encoder from the tree. */
     HuffmanEncoder(std::ostream& os, const HuffmanTree<Symbol> *tree)
-        : os(os), table(build_huffman_table(tree))
+        : HuffmanEncoder(os, build_huffman_table(tree))
+    {}
+
+    /* Construct Huffman encoder sharing the codebook of the dictionary, which costs no table build. */
+    HuffmanEncoder(std::ostream& os, const HuffmanDictionary<Symbol>& dictionary)
+        : writer(os), codebook(dictionary.get_codebook())
     {}
 
     /* Construct Huffman encoder with optimal codeword table for the provided symbol stream. */
     template<typename SymbolIt>
     HuffmanEncoder(std::ostream& os, SymbolIt begin, SymbolIt end)
-        : os(os)
-    {
-        auto tree = build_huffman_tree(begin, end);
-        table = build_huffman_table(tree.get());
-    }
+        : HuffmanEncoder(os, build_huffman_tree(begin, end))
+    {}
 
     ~HuffmanEncoder()
     {
@@ -206,14 +462,10 @@ public:
     /* Encode one symbol and write to the output stream. */
     void put_sym(const Symbol& symbol)
     {
-        for (char c : table[symbol]) {
-            if (!off_left--) {
-                off_left = 7;
-                os.put(unwritten_bits);
-                unwritten_bits = 0;
-            }
-            unwritten_bits = (unwritten_bits << 1) + (c != '0');
-        }
+        auto it = codebook->find(symbol);
+        if (it == codebook->end())
+            throw Error<HuffmanEncoder>("The symbol has no codeword in the Huffman table");
+        writer.put(it->second.bits, it->second.length);
     }
 
     /* Encode symbol stream and write to the output stream. */
@@ -227,16 +479,12 @@ public:
     /* Finalize the stream by writing last unwritten bits followed by zero bits. */
     void finalize()
     {
-        if (off_left & 7)
-            os.put(unwritten_bits << off_left);
-        off_left = 8;
+        writer.flush();
     }
 
 private:
-    std::ostream& os; /* The output stream where the encoded data is written to. */
-    HuffmanTable<Symbol> table; /* Huffman codeword table. */
-    int off_left = 8; /* Offset left to fill to send 8 bits to the stream. */
-    char unwritten_bits = 0; /* Unwritten bits of last encoded data. */
+    BitWriter writer; /* Bit writer over the output stream where the encoded data is written to. */
+    std::shared_ptr<const HuffmanCodebook<Symbol>> codebook; /* Huffman codebook, possibly shared. */
 };
 
 
@@ -244,9 +492,82 @@ private:
 template<typename Symbol>
 class HuffmanDecoder {
 public:
+    /* Input iterator over the symbols decoded on the fly, which lets algorithms consume
+     * the decoded stream without materializing it. */
+    class Iterator {
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = Symbol;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const Symbol *;
+        using reference = const Symbol&;
+
+        /* Construct the end iterator. */
+        Iterator() = default;
+
+        /* Construct the iterator decoding at most nr_symbols symbols. */
+        Iterator(HuffmanDecoder *decoder, size_t nr_symbols)
+            : decoder(decoder), nr_left(nr_symbols)
+        {
+            next();
+        }
+
+        inline const Symbol& operator*() const
+        {
+            return *symbol;
+        }
+
+        inline const Symbol *operator->() const
+        {
+            return &*symbol;
+        }
+
+        Iterator& operator++()
+        {
+            ++index;
+            next();
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        /* Get the index of the current symbol in the decoded stream (the number of symbols before it). */
+        inline size_t get_index() const
+        {
+            return index;
+        }
+
+        inline bool operator==(const Iterator& other) const
+        {
+            return decoder == other.decoder;
+        }
+
+    private:
+        void next()
+        {
+            if (nr_left && (symbol = decoder->get_sym()))
+                --nr_left;
+            else
+                decoder = nullptr;
+        }
+
+        HuffmanDecoder *decoder = nullptr; /* The decoder, or null for the end iterator. */
+        std::optional<Symbol> symbol; /* The current symbol. */
+        size_t nr_left = 0; /* Number of symbols left to decode. */
+        size_t index = 0; /* Index of the current symbol. */
+    };
+
     /* Construct Huffman decoder from the tree (the tree must be alive throughout the lifetime of the decoder). */
-    HuffmanDecoder(std::istream& is, HuffmanTree<Symbol>& tree)
-        : is(is), tree(tree)
+    HuffmanDecoder(std::istream& is, const HuffmanTree<Symbol>& tree)
+        : reader(is), tree(tree)
+    {}
+
+    /* Construct Huffman decoder from the dictionary (the dictionary must be alive throughout the lifetime of the decoder). */
+    HuffmanDecoder(std::istream& is, const HuffmanDictionary<Symbol>& dictionary)
+        : reader(is), tree(dictionary.get_tree())
     {}
 
     /* Read one symbol from the input stream. */
@@ -254,13 +575,17 @@ public:
     {
         std::optional<Symbol> opt_symbol;
         while (!(opt_symbol = curr->get_symbol())) {
-            if (!off_left--) {
-                off_left = 7;
-                unread_bits = is.get();
-                if (is.eof())
-                    return std::nullopt;
-            }
-            curr = unread_bits & (1 << off_left) ? curr->get_right() : curr->get_left();
+            const unsigned nr_bits = reader.available();
+            if (!nr_bits)
+                return std::nullopt;
+
+            // walk down the tree over a batch of peeked bits, consuming only the walked ones
+            const uint64_t bits = reader.peek(nr_bits);
+            unsigned nr_walked = 0;
+            do {
+                curr = bits >> (nr_bits - ++nr_walked) & 1 ? curr->get_right() : curr->get_left();
+            } while (nr_walked < nr_bits && !curr->get_symbol());
+            reader.consume(nr_walked);
         }
         curr = &tree;
         return opt_symbol;
@@ -278,23 +603,181 @@ public:
         }
     }
 
-    /* Reset the decoder state. */
+    /* Get the iterator decoding at most nr_symbols symbols from the input stream.
+     * Limiting the number of symbols prevents the padding bits from decoding into spurious symbols. */
+    inline Iterator begin(size_t nr_symbols = std::numeric_limits<size_t>::max())
+    {
+        return Iterator(this, nr_symbols);
+    }
+
+    inline Iterator end()
+    {
+        return Iterator();
+    }
+
+    /* Reset the decoder state, discarding the bits read ahead from the stream. */
     void reset()
     {
         curr = &tree;
-        off_left = 0;
-        unread_bits = 0;
+        reader.reset();
     }
 
 private:
-    std::istream& is; /* The input stream from which the encoded data is read. */
-    HuffmanTree<Symbol>& tree; /* Reference to the Huffman tree. */
-    HuffmanTree<Symbol> *curr = &tree; /* Last visited Huffman tree node during decoding. */
-    int off_left = 0; /* Offset of unread bits. */
-    char unread_bits = 0; /* Unread bits. */
+    BitReader reader; /* Bit reader over the input stream from which the encoded data is read. */
+    const HuffmanTree<Symbol>& tree; /* Reference to the Huffman tree. */
+    const HuffmanTree<Symbol> *curr = &tree; /* Last visited Huffman tree node during decoding. */
 };
 
 
+/* Coding mode of a Huffman block, chosen by the entropy estimate before building any tree. */
+enum class HuffmanBlockMode : uint8_t {
+    Stored = 0, /* The symbols as they are, for incompressible data. */
+    SingleSymbol = 1, /* One symbol repeated throughout the block. */
+    Huffman = 2, /* The saved dictionary followed by the Huffman encoded symbols. */
+};
+
+
+/* Encode the symbols as one self-contained block: the mode, the symbol count and the payload size
+ * followed by the payload. The Huffman tree is only built if the entropy estimate predicts that
+ * the encoded block will be smaller than the stored one, so incompressible data is copied as it is. */
+template<typename SymbolIt>
+HuffmanBlockMode huffman_encode_block(std::ostream& os, SymbolIt begin, SymbolIt end)
+{
+    using Symbol = std::iter_value_t<SymbolIt>;
+    static_assert(std::is_trivially_copyable_v<Symbol>, "Only trivially copyable symbols can be stored");
+
+    const auto sym_freq = count_sym_freq(begin, end);
+    size_t count = 0;
+    for (const auto& [symbol, freq] : sym_freq)
+        count += freq;
+    const size_t stored_size = count * sizeof(Symbol);
+
+    auto write_header = [&](HuffmanBlockMode mode, size_t payload_size)
+    {
+        os.put(static_cast<char>(mode));
+        __write_le<uint64_t>(os, count);
+        __write_le<uint64_t>(os, payload_size);
+    };
+
+    if (sym_freq.size() == 1) {
+        write_header(HuffmanBlockMode::SingleSymbol, sizeof(Symbol));
+        os.write(reinterpret_cast<const char *>(&sym_freq.begin()->first), sizeof(Symbol));
+        return HuffmanBlockMode::SingleSymbol;
+    }
+
+    // the dictionary holds 2n - 1 tree nodes, n of which are leaves carrying a symbol each
+    const size_t dictionary_size = 5 + 2 * sym_freq.size() - 1 + sym_freq.size() * sizeof(Symbol);
+    std::string payload;
+    if (count && estimate_encoded_size(sym_freq) + dictionary_size < stored_size) {
+        std::ostringstream oss {std::ios_base::binary};
+        const HuffmanDictionary<Symbol> dictionary {build_huffman_tree(sym_freq)};
+        dictionary.save(oss);
+        HuffmanEncoder<Symbol> encoder {oss, dictionary};
+        encoder.write_syms(begin, end);
+        encoder.finalize();
+        payload = std::move(oss).str();
+    }
+
+    // the estimate is a lower bound, so the encoded payload may still turn out larger
+    if (!payload.empty() && payload.size() < stored_size) {
+        write_header(HuffmanBlockMode::Huffman, payload.size());
+        os.write(payload.data(), payload.size());
+        return HuffmanBlockMode::Huffman;
+    }
+
+    write_header(HuffmanBlockMode::Stored, stored_size);
+    if constexpr (std::contiguous_iterator<SymbolIt>) {
+        os.write(reinterpret_cast<const char *>(std::to_address(begin)), stored_size);
+    } else {
+        for (auto it = begin; it != end; ++it) {
+            const Symbol symbol = *it;
+            os.write(reinterpret_cast<const char *>(&symbol), sizeof(Symbol));
+        }
+    }
+    return HuffmanBlockMode::Stored;
+}
+
+
+/* Decode one block written by huffman_encode_block() and write its symbols to the output iterator.
+ * Returns the iterator past the last written symbol, or nothing if the stream has ended. */
+template<typename Symbol, typename SymbolOutIt>
+std::optional<SymbolOutIt> huffman_decode_block(std::istream& is, SymbolOutIt out)
+{
+    static_assert(std::is_trivially_copyable_v<Symbol>, "Only trivially copyable symbols can be stored");
+
+    const auto mode = is.get();
+    if (is.eof())
+        return std::nullopt;
+    const auto opt_count = __read_le<uint64_t>(is);
+    const auto opt_payload_size = __read_le<uint64_t>(is);
+    if (!opt_count || !opt_payload_size)
+        throw Error<HuffmanBlockMode>("Unexpected end of the Huffman block");
+    const size_t count = *opt_count;
+    const uint64_t payload_size = *opt_payload_size;
+
+    // the header is untrusted, so the payload size is checked against the mode before anything is allocated:
+    // the encoder only picks the Huffman mode when its payload is smaller than the stored symbols
+    if (count > std::numeric_limits<uint64_t>::max() / sizeof(Symbol))
+        throw Error<HuffmanBlockMode>("Too many symbols in the Huffman block");
+    switch (static_cast<HuffmanBlockMode>(mode)) {
+    case HuffmanBlockMode::Stored:
+        if (payload_size != count * sizeof(Symbol))
+            throw Error<HuffmanBlockMode>("Mismatching size of the stored Huffman block");
+        break;
+    case HuffmanBlockMode::SingleSymbol:
+        if (payload_size != sizeof(Symbol))
+            throw Error<HuffmanBlockMode>("Mismatching size of the single symbol Huffman block");
+        break;
+    case HuffmanBlockMode::Huffman:
+        if (payload_size >= count * sizeof(Symbol))
+            throw Error<HuffmanBlockMode>("Mismatching size of the Huffman encoded block");
+        break;
+    default:
+        throw Error<HuffmanBlockMode>("Unknown Huffman block mode", mode);
+    }
+
+    // the count may still be forged, so the payload grows by bounded chunks as it actually arrives
+    constexpr size_t chunk_size = 1 << 16;
+    std::string payload;
+    while (payload.size() < payload_size) {
+        const size_t prev_size = payload.size();
+        payload.resize(prev_size + static_cast<size_t>(std::min<uint64_t>(chunk_size, payload_size - prev_size)));
+        is.read(payload.data() + prev_size, payload.size() - prev_size);
+        if (static_cast<size_t>(is.gcount()) != payload.size() - prev_size)
+            throw Error<HuffmanBlockMode>("Unexpected end of the Huffman block");
+    }
+
+    switch (static_cast<HuffmanBlockMode>(mode)) {
+    case HuffmanBlockMode::Stored: {
+        for (size_t i = 0; i < count; ++i) {
+            Symbol symbol;
+            std::memcpy(&symbol, payload.data() + i * sizeof(Symbol), sizeof(Symbol));
+            *out++ = symbol;
+        }
+        return out;
+    }
+    case HuffmanBlockMode::SingleSymbol: {
+        Symbol symbol;
+        std::memcpy(&symbol, payload.data(), sizeof(Symbol));
+        return std::fill_n(out, count, symbol);
+    }
+    case HuffmanBlockMode::Huffman: {
+        std::istringstream iss {std::move(payload), std::ios_base::binary};
+        const auto dictionary = HuffmanDictionary<Symbol>::load(iss);
+        HuffmanDecoder<Symbol> decoder {iss, dictionary};
+        for (size_t i = 0; i < count; ++i) {
+            auto opt_symbol = decoder.get_sym();
+            if (!opt_symbol)
+                throw Error<HuffmanBlockMode>("Unexpected end of the Huffman encoded symbols");
+            *out++ = *opt_symbol;
+        }
+        return out;
+    }
+    }
+    throw Error<HuffmanBlockMode>("Unknown Huffman block mode", mode);
+}
+
+
 /* Huffman basic string encoder designed for compressing character streams. */
 template<typename Char>
 class HuffmanBasicStringEncoder : public HuffmanEncoder<Char> {
@@ -307,6 +790,10 @@ public:
         : HuffmanEncoder<Char>(os, tree)
     {}
 
+    HuffmanBasicStringEncoder(std::ostream& os, const HuffmanDictionary<Char>& dictionary)
+        : HuffmanEncoder<Char>(os, dictionary)
+    {}
+
     template<typename CharIt>
     HuffmanBasicStringEncoder(std::ostream& os, CharIt begin, CharIt end)
         : HuffmanEncoder<Char>(os, begin, end)
@@ -371,10 +858,14 @@ using HuffmanWStringEncoder = HuffmanBasicStringEncoder<wchar_t>;
 template<typename Char>
 class HuffmanBasicStringDecoder : HuffmanDecoder<Char> {
 public:
-    HuffmanBasicStringDecoder(std::istream& is, HuffmanTree<Char>& tree)
+    HuffmanBasicStringDecoder(std::istream& is, const HuffmanTree<Char>& tree)
         : HuffmanDecoder<Char>(is, tree)
     {}
 
+    HuffmanBasicStringDecoder(std::istream& is, const HuffmanDictionary<Char>& dictionary)
+        : HuffmanDecoder<Char>(is, dictionary)
+    {}
+
     inline std::optional<Char> getc()
     {
         return HuffmanDecoder<Char>::get_sym();
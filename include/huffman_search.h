@@ -0,0 +1,42 @@
+#pragma once
+
+/*
+ * Pattern search on Huffman encoded data: the KMP automaton runs on the symbols as they are decoded
+ * */
+
+#include <cstddef>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <istream>
+#include <vector>
+
+#include "huffman_coding.h"
+#include "kmp_pattern_search.h"
+
+
+/* Find the first occurrence of the pattern among the next nr_symbols symbols of the Huffman encoded stream.
+ * The symbols are fed into the KMP automaton as they are decoded, so the decoded data is never stored.
+ * Returns the index of the first symbol of the match, or nothing. */
+template<typename Symbol, std::random_access_iterator PatIt, typename Size,
+    typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>>
+std::optional<size_t> huffman_find_pattern(HuffmanDecoder<Symbol>& decoder, PatIt pattern, Size pattern_size,
+        size_t nr_symbols = std::numeric_limits<size_t>::max(), const ChrEqual& chr_equal = ChrEqual())
+{
+    if (pattern_size == 0)
+        return 0;
+
+    std::vector<Size> lps (pattern_size);
+    build_lps(pattern, lps.begin(), pattern_size, chr_equal);
+    auto [it, match_len] = kmp_find_pattern_raw(decoder.begin(nr_symbols), decoder.end(),
+            pattern, lps.begin(), pattern_size, chr_equal);
+    if (match_len != pattern_size)
+        return std::nullopt;
+
+    // the iterator stands right past the match, even if it has reached the end of the stream
+    return it.get_index() - pattern_size;
+}
+
+
+std::size_t huffman_str_find(std::istream& is, const HuffmanDictionary<char>& dictionary, std::string_view pat,
+        std::size_t nr_symbols = std::numeric_limits<std::size_t>::max());
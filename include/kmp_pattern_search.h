@@ -1,20 +1,32 @@
 #pragma once
 
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
 #include <vector>
 #include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <concepts>
 #include <string_view>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <span>
 
 
 template<std::random_access_iterator PatIt, std::random_access_iterator LpsIt,
     typename Size = std::iter_value_t<LpsIt>,
     typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
     typename = std::enable_if_t<std::is_integral_v<std::iter_value_t<LpsIt>>>>
-void build_lps(PatIt pattern, LpsIt lps, Size size,
+constexpr void build_lps(PatIt pattern, LpsIt lps, Size size,
         const ChrEqual& chr_equal = ChrEqual())
 {
+    if (size == 0)
+        return;
     lps[0] = 0;
     for (Size i = 1; i < size; ++i) {
         auto j = lps[i - 1];
@@ -27,22 +39,23 @@ void build_lps(PatIt pattern, LpsIt lps, Size size,
                 lps[i] = 0;
                 break;
             }
-            j = lps[j];
+            j = lps[j - 1];
         }
     }
 }
 
 
+/* Continue the search in the state where j characters of the pattern are already matched;
+ * stop after a full match or at the end of the string. Return the position where it stopped and the matched length. */
 template<std::input_iterator StrIt, std::random_access_iterator PatIt,
     std::random_access_iterator LpsIt, typename Size = std::iter_value_t<LpsIt>,
     typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
     typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>
         && std::is_integral_v<std::iter_value_t<LpsIt>>
         && std::is_convertible_v<Size, std::iter_value_t<LpsIt>> > >
-std::pair<StrIt, Size> kmp_find_pattern_raw(StrIt str_beg, StrIt str_end, PatIt pattern,
-        LpsIt lps, Size pattern_size, const ChrEqual& chr_equal = ChrEqual())
+constexpr std::pair<StrIt, Size> kmp_resume_pattern_raw(StrIt str_beg, StrIt str_end, PatIt pattern,
+        LpsIt lps, Size pattern_size, Size j, const ChrEqual& chr_equal = ChrEqual())
 {
-    Size j = 0;
     StrIt it = str_beg;
     for (; it != str_end && j < pattern_size; ++it) {
         while (true) {
@@ -52,16 +65,28 @@ std::pair<StrIt, Size> kmp_find_pattern_raw(StrIt str_beg, StrIt str_end, PatIt
             }
             if (j == 0)
                 break;
-            j = static_cast<std::iter_value_t<LpsIt>>(lps[j]);
+            j = static_cast<std::iter_value_t<LpsIt>>(lps[j - 1]);
         }
     }
     return std::make_pair(it, j);
 }
 
+template<std::input_iterator StrIt, std::random_access_iterator PatIt,
+    std::random_access_iterator LpsIt, typename Size = std::iter_value_t<LpsIt>,
+    typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
+    typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>
+        && std::is_integral_v<std::iter_value_t<LpsIt>>
+        && std::is_convertible_v<Size, std::iter_value_t<LpsIt>> > >
+constexpr std::pair<StrIt, Size> kmp_find_pattern_raw(StrIt str_beg, StrIt str_end, PatIt pattern,
+        LpsIt lps, Size pattern_size, const ChrEqual& chr_equal = ChrEqual())
+{
+    return kmp_resume_pattern_raw(str_beg, str_end, pattern, lps, pattern_size, Size(0), chr_equal);
+}
+
 template<std::input_iterator StrIt, std::random_access_iterator PatIt,
     typename Size, typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
     typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>>>
-std::pair<StrIt, Size> kmp_find_pattern_raw(StrIt str_beg, StrIt str_end,
+constexpr std::pair<StrIt, Size> kmp_find_pattern_raw(StrIt str_beg, StrIt str_end,
         PatIt pattern, Size pattern_size, const ChrEqual& chr_equal = ChrEqual())
 {
     std::vector<Size> lps (pattern_size);
@@ -76,7 +101,7 @@ template<std::random_access_iterator StrIt, std::random_access_iterator PatIt,
     typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>
         && std::is_integral_v<std::iter_value_t<LpsIt>>
         && std::is_convertible_v<Size, std::iter_value_t<LpsIt>> > >
-StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end, PatIt pattern, LpsIt lps,
+constexpr StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end, PatIt pattern, LpsIt lps,
         Size size, const ChrEqual& chr_equal = ChrEqual())
 {
     auto [end_it, match_len] = kmp_find_pattern_raw(str_beg, str_end, pattern, lps, size, chr_equal);
@@ -86,7 +111,7 @@ StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end, PatIt pattern, LpsIt lps,
 template<std::random_access_iterator StrIt, std::random_access_iterator PatIt,
     typename Size, typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
     typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>>>
-StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end,
+constexpr StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end,
         PatIt pattern, Size pattern_size, const ChrEqual& chr_equal = ChrEqual())
 {
     auto [end_it, match_len] = kmp_find_pattern_raw(str_beg, str_end, pattern, pattern_size, chr_equal);
@@ -94,6 +119,657 @@ StrIt kmp_find_pattern(StrIt str_beg, StrIt str_end,
 }
 
 
+/* Fold an ASCII letter to lower case; other characters are left as they are. */
+constexpr char ascii_fold(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+/* Character comparison that ignores the case of ASCII letters, for use as ChrEqual. */
+struct AsciiFoldEqual {
+    constexpr bool operator()(char a, char b) const
+    {
+        return ascii_fold(a) == ascii_fold(b);
+    }
+};
+
+
+/* Boyer-Moore-Horspool search: the pattern is compared right to left at each alignment, which is then shifted
+ * by the distance from the last occurrence of the aligned last character to the end of the pattern.
+ * Most text characters are skipped for long patterns over large alphabets, but the worst case is O(n * m).
+ * The shift table is a flat array for 1-byte characters compared with std::equal_to,
+ * otherwise a hash map, whose Hash must agree with ChrEqual. Return str_end if there is no match. */
+template<std::random_access_iterator StrIt, std::random_access_iterator PatIt,
+    typename Size, typename ChrEqual = std::equal_to<std::iter_value_t<PatIt>>,
+    typename Hash = std::hash<std::iter_value_t<PatIt>>,
+    typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>>>
+StrIt horspool_find_pattern(StrIt str_beg, StrIt str_end, PatIt pattern, Size pattern_size,
+        const ChrEqual& chr_equal = ChrEqual(), const Hash& hash = Hash())
+{
+    using Chr = std::iter_value_t<PatIt>;
+    const std::size_t m = pattern_size, n = str_end - str_beg;
+    if (m == 0)
+        return str_beg;
+    if (m > n)
+        return str_end;
+
+    auto search = [&](auto&& shift_of) -> StrIt
+    {
+        for (std::size_t i = 0; i + m <= n; i += shift_of(str_beg[i + m - 1])) {
+            for (std::size_t j = m - 1; chr_equal(str_beg[i + j], pattern[j]); --j)
+                if (j == 0)
+                    return str_beg + i;
+        }
+        return str_end;
+    };
+
+    if constexpr (sizeof(Chr) == 1 && std::is_integral_v<Chr> && std::is_same_v<ChrEqual, std::equal_to<Chr>>) {
+        std::array<std::size_t, 256> shifts;
+        shifts.fill(m);
+        for (std::size_t k = 0; k + 1 < m; ++k)
+            shifts[static_cast<unsigned char>(pattern[k])] = m - 1 - k;
+        return search([&shifts](Chr c) { return shifts[static_cast<unsigned char>(c)]; });
+    } else {
+        std::unordered_map<Chr, std::size_t, Hash, ChrEqual> shifts (m, hash, chr_equal);
+        for (std::size_t k = 0; k + 1 < m; ++k)
+            shifts.insert_or_assign(pattern[k], m - 1 - k);
+        return search([&shifts, m](const Chr& c)
+                {
+                    auto it = shifts.find(c);
+                    return it == shifts.end() ? m : it->second;
+                });
+    }
+}
+
+
+/* Get the start of the maximal suffix of the pattern under the order (or the reversed one) and its period.
+ * The start is -1 based, as in the original formulation of the Two-Way algorithm. */
+template<std::random_access_iterator PatIt, typename ChrLess>
+std::pair<std::ptrdiff_t, std::ptrdiff_t> __two_way_max_suffix(PatIt pattern, std::ptrdiff_t m,
+        const ChrLess& chr_less, bool reversed)
+{
+    std::ptrdiff_t ms = -1, j = 0, k = 1, p = 1;
+    while (j + k < m) {
+        const auto& a = pattern[j + k];
+        const auto& b = pattern[ms + k];
+        if (reversed ? chr_less(b, a) : chr_less(a, b)) {
+            j += k;
+            k = 1;
+            p = j - ms;
+        } else if (!chr_less(a, b) && !chr_less(b, a)) {
+            if (k != p) {
+                ++k;
+            } else {
+                j += p;
+                k = 1;
+            }
+        } else {
+            ms = j;
+            j = ms + 1;
+            k = p = 1;
+        }
+    }
+    return {ms, p};
+}
+
+/* Two-Way (Crochemore-Perrin) search: the pattern is split at a critical factorization, the right part
+ * is matched left to right and then the left part right to left, and the shifts follow from the period.
+ * Linear time in the worst case with constant extra space; characters only need to be ordered by ChrLess.
+ * Return str_end if there is no match. */
+template<std::random_access_iterator StrIt, std::random_access_iterator PatIt,
+    typename Size, typename ChrLess = std::less<std::iter_value_t<PatIt>>,
+    typename = std::enable_if_t<std::is_same_v<std::iter_value_t<StrIt>, std::iter_value_t<PatIt>>>>
+StrIt two_way_find_pattern(StrIt str_beg, StrIt str_end, PatIt pattern, Size pattern_size,
+        const ChrLess& chr_less = ChrLess())
+{
+    const std::ptrdiff_t m = pattern_size, n = str_end - str_beg;
+    if (m == 0)
+        return str_beg;
+    if (m > n)
+        return str_end;
+
+    auto chr_equal = [&chr_less](const auto& a, const auto& b) { return !chr_less(a, b) && !chr_less(b, a); };
+
+    const auto [ms, p] = __two_way_max_suffix(pattern, m, chr_less, false);
+    const auto [ms_rev, p_rev] = __two_way_max_suffix(pattern, m, chr_less, true);
+    const std::ptrdiff_t ell = std::max(ms, ms_rev);
+    std::ptrdiff_t period = ms > ms_rev ? p : p_rev;
+
+    bool periodic = ell + 1 + period <= m;
+    for (std::ptrdiff_t i = 0; periodic && i <= ell; ++i)
+        periodic = chr_equal(pattern[i], pattern[i + period]);
+
+    if (periodic) {
+        // the left part is known to match after a shift by the period, up to memory
+        std::ptrdiff_t memory = -1;
+        for (std::ptrdiff_t j = 0; j <= n - m;) {
+            std::ptrdiff_t i = std::max(ell, memory) + 1;
+            while (i < m && chr_equal(pattern[i], str_beg[i + j]))
+                ++i;
+            if (i < m) {
+                j += i - ell;
+                memory = -1;
+                continue;
+            }
+            i = ell;
+            while (i > memory && chr_equal(pattern[i], str_beg[i + j]))
+                --i;
+            if (i <= memory)
+                return str_beg + j;
+            j += period;
+            memory = m - period - 1;
+        }
+    } else {
+        period = std::max(ell + 1, m - ell - 1) + 1;
+        for (std::ptrdiff_t j = 0; j <= n - m;) {
+            std::ptrdiff_t i = ell + 1;
+            while (i < m && chr_equal(pattern[i], str_beg[i + j]))
+                ++i;
+            if (i < m) {
+                j += i - ell;
+                continue;
+            }
+            i = ell;
+            while (i >= 0 && chr_equal(pattern[i], str_beg[i + j]))
+                --i;
+            if (i < 0)
+                return str_beg + j;
+            j += period;
+        }
+    }
+    return str_end;
+}
+
+
 std::size_t kmp_str_find_pattern(std::string_view str, std::string_view pat);
 
 std::size_t kmp_str_find(std::string_view str, std::string_view pat);
+
+std::size_t kmp_str_find(std::u16string_view str, std::u16string_view pat);
+
+std::size_t kmp_str_find(std::u32string_view str, std::u32string_view pat);
+
+std::size_t horspool_str_find(std::string_view str, std::string_view pat);
+
+std::size_t two_way_str_find(std::string_view str, std::string_view pat);
+
+
+/* Whether the matches reported by kmp_find_all and kmp_count may overlap.
+ * The empty pattern has no matches: every count of it is 0 and find_all is empty, while find returns 0
+ * like std::string_view::find. */
+enum class KmpMatchMode {
+    Overlapping, NonOverlapping
+};
+
+
+class KmpMatchView;
+
+/* Compiled KMP pattern that owns a copy of the pattern and its lps array, built once and reused by every search.
+ * Patterns of up to inline_capacity characters are stored inline, so compiling them allocates nothing
+ * and can be done at compile time. The object is immutable, so it can be shared across threads. */
+class KmpPattern {
+public:
+    static constexpr std::size_t inline_capacity = 32;
+
+    constexpr KmpPattern() = default;
+
+    constexpr explicit KmpPattern(std::string_view pattern) : pattern_size(pattern.size())
+    {
+        if (pattern_size <= inline_capacity) {
+            std::copy(pattern.begin(), pattern.end(), inline_pattern.begin());
+            build_lps(inline_pattern.begin(), inline_lps.begin(), pattern_size);
+        } else {
+            heap_pattern.assign(pattern.begin(), pattern.end());
+            heap_lps.resize(pattern_size);
+            build_lps(heap_pattern.begin(), heap_lps.begin(), pattern_size);
+        }
+    }
+
+    /* Get the size of the pattern. */
+    constexpr std::size_t size() const
+    {
+        return pattern_size;
+    }
+
+    /* Get the pattern. */
+    constexpr std::string_view pattern() const
+    {
+        return {is_inline() ? inline_pattern.data() : heap_pattern.data(), pattern_size};
+    }
+
+    /* Find the first occurrence of the pattern; npos if there is none. */
+    std::size_t find(std::string_view str) const;
+
+    /* Get a lazy view of the positions of all matches of the pattern; the object must outlive the view. */
+    KmpMatchView find_all(std::string_view str, KmpMatchMode mode = KmpMatchMode::Overlapping) const;
+
+    /* Count the matches of the pattern without materializing their positions. */
+    std::size_t count(std::string_view str, KmpMatchMode mode = KmpMatchMode::Overlapping) const;
+
+private:
+    friend class KmpMatchView;
+    friend class KmpStreamMatcher;
+
+    constexpr bool is_inline() const
+    {
+        return pattern_size <= inline_capacity;
+    }
+
+    /* Call the visitor with the pointers to the pattern and its lps array, whichever storage they are in. */
+    template<typename Visitor>
+    constexpr decltype(auto) visit(Visitor&& visitor) const
+    {
+        return is_inline() ? visitor(inline_pattern.data(), inline_lps.data())
+            : visitor(heap_pattern.data(), heap_lps.data());
+    }
+
+    /* Search from the given position with j characters already matched;
+     * return the position of the match, or npos if there is none. */
+    std::size_t resume(std::string_view str, std::size_t from, std::size_t j) const;
+
+    /* Get the state to continue from after a match. */
+    std::size_t restart_state(KmpMatchMode mode) const;
+
+    std::size_t pattern_size = 0;
+    std::array<char, inline_capacity> inline_pattern {};
+    std::array<std::uint8_t, inline_capacity> inline_lps {};
+    std::vector<char> heap_pattern; /* Used instead of the inline storage for long patterns. */
+    std::vector<std::size_t> heap_lps;
+};
+
+
+/* Lazy view of the positions of all matches of the pattern in the string, in increasing order.
+ * The search is resumed after each match instead of restarted: in the state of the pattern's
+ * longest border in the overlapping mode, in the initial state otherwise.
+ * An empty pattern has no matches. The view refers to the string, which must outlive it. */
+class KmpMatchView : public std::ranges::view_interface<KmpMatchView> {
+public:
+    class Iterator {
+    public:
+        using value_type = std::size_t;
+        using difference_type = std::ptrdiff_t;
+
+        Iterator() = default;
+
+        inline std::size_t operator*() const
+        {
+            return pos;
+        }
+
+        inline Iterator& operator++()
+        {
+            pos = view->pattern->resume(view->str, pos + view->pattern->size(),
+                    view->pattern->restart_state(view->mode));
+            return *this;
+        }
+
+        inline Iterator operator++(int)
+        {
+            Iterator it = *this;
+            ++*this;
+            return it;
+        }
+
+        inline bool operator==(const Iterator& other) const
+        {
+            return pos == other.pos;
+        }
+
+        inline bool operator==(std::default_sentinel_t) const
+        {
+            return pos == std::string_view::npos;
+        }
+
+    private:
+        friend class KmpMatchView;
+
+        explicit Iterator(const KmpMatchView *view)
+            : view(view), pos(view->pattern->size() ? view->pattern->resume(view->str, 0, 0) : std::string_view::npos)
+        {}
+
+        const KmpMatchView *view = nullptr;
+        std::size_t pos = std::string_view::npos; /* Position of the current match; npos past the last one. */
+    };
+
+    KmpMatchView() = default;
+
+    /* Compile the pattern and view its matches. */
+    KmpMatchView(std::string_view str, std::string_view pat, KmpMatchMode mode = KmpMatchMode::Overlapping);
+
+    /* View the matches of the compiled pattern, which must outlive the view. */
+    KmpMatchView(std::string_view str, const KmpPattern& pattern, KmpMatchMode mode = KmpMatchMode::Overlapping);
+
+    inline Iterator begin() const
+    {
+        return Iterator(this);
+    }
+
+    inline std::default_sentinel_t end() const
+    {
+        return std::default_sentinel;
+    }
+
+private:
+    std::string_view str;
+    std::shared_ptr<const KmpPattern> pattern; /* Owned by the view only if it compiled the pattern itself. */
+    KmpMatchMode mode = KmpMatchMode::Overlapping;
+};
+
+
+/* Get a lazy view of the positions of all matches of the pattern in the string. */
+KmpMatchView kmp_find_all(std::string_view str, std::string_view pat,
+        KmpMatchMode mode = KmpMatchMode::Overlapping);
+
+/* Count the matches of the pattern in the string without materializing their positions. */
+std::size_t kmp_count(std::string_view str, std::string_view pat,
+        KmpMatchMode mode = KmpMatchMode::Overlapping);
+
+
+/* Stateful KMP matcher for data arriving in chunks. The matched length is kept between the chunks,
+ * so matches straddling chunk boundaries are found without buffering or copying the input.
+ * Matches are reported by their absolute offsets in the whole stream. */
+class KmpStreamMatcher {
+public:
+    explicit KmpStreamMatcher(KmpPattern pattern, KmpMatchMode mode = KmpMatchMode::Overlapping)
+        : pattern(std::move(pattern)),
+          restart(this->pattern.size() ? this->pattern.restart_state(mode) : 0)
+    {}
+
+    explicit KmpStreamMatcher(std::string_view pattern, KmpMatchMode mode = KmpMatchMode::Overlapping)
+        : KmpStreamMatcher(KmpPattern(pattern), mode)
+    {}
+
+    /* Feed the next chunk and call on_match(offset) for every match ending in it. */
+    template<typename OnMatch>
+    void feed(std::span<const char> chunk, OnMatch&& on_match)
+    {
+        const std::size_t m = pattern.size();
+        if (m > 0) {
+            pattern.visit([&](const char *pat, const auto *lps)
+                    {
+                        std::size_t j = matched;
+                        for (std::size_t i = 0; i < chunk.size(); ++i) {
+                            const char c = chunk[i];
+                            while (j > 0 && c != pat[j])
+                                j = lps[j - 1];
+                            if (c == pat[j] && ++j == m) {
+                                on_match(offset + i + 1 - m);
+                                j = restart;
+                            }
+                        }
+                        matched = j;
+                    });
+        }
+        offset += chunk.size();
+    }
+
+    /* Feed the next chunk and get the offsets of the matches ending in it. */
+    std::vector<std::size_t> feed(std::span<const char> chunk)
+    {
+        std::vector<std::size_t> matches;
+        feed(chunk, [&matches](std::size_t match) { matches.push_back(match); });
+        return matches;
+    }
+
+    /* Get the number of bytes fed so far. */
+    inline std::size_t position() const
+    {
+        return offset;
+    }
+
+    /* Start a new stream. */
+    inline void reset()
+    {
+        offset = 0;
+        matched = 0;
+    }
+
+private:
+    KmpPattern pattern;
+    std::size_t restart; /* State to continue from after a match. */
+    std::size_t matched = 0; /* Length of the pattern's prefix matched at the end of the fed data. */
+    std::size_t offset = 0; /* Number of bytes fed so far. */
+};
+
+
+/* Parallel search over large buffers: the string is split into per-thread segments of match start positions,
+ * each searched together with the following pattern size - 1 characters, so no match is lost or reported twice.
+ * Overlapping matches are reported. The number of threads defaults to the hardware concurrency,
+ * and is reduced for short strings. */
+
+/* Find the first match in parallel; the threads stop as soon as a match before their position is found. */
+std::size_t kmp_parallel_find(std::string_view str, const KmpPattern& pattern, unsigned nr_threads = 0);
+
+/* Find the positions of all matches in parallel, in increasing order. */
+std::vector<std::size_t> kmp_parallel_find_all(std::string_view str, const KmpPattern& pattern,
+        unsigned nr_threads = 0);
+
+/* Count the matches in parallel. */
+std::size_t kmp_parallel_count(std::string_view str, const KmpPattern& pattern, unsigned nr_threads = 0);
+
+
+/* String literal that can be passed as a template argument. */
+template<std::size_t N>
+struct KmpLiteral {
+    constexpr KmpLiteral(const char (&str)[N])
+    {
+        std::copy_n(str, N, chars);
+    }
+
+    constexpr std::size_t size() const
+    {
+        return N - 1;
+    }
+
+    char chars[N];
+};
+
+/* KMP pattern fixed at compile time, e.g. KmpFixedPattern<"literal">, whose tables are computed by the compiler,
+ * so there is no setup at runtime and the search loop is specialized for the pattern.
+ * Patterns of up to max_unrolled_size characters are matched by finding the first character and comparing
+ * the rest with an unrolled sequence of comparisons; longer ones of up to max_dfa_size characters run
+ * a byte-level DFA with 8-bit states, which skips to the next occurrence of the first character
+ * whenever it is in the initial state; the longest ones run KMP over the lps array.
+ * All the searches can also be evaluated at compile time. */
+template<KmpLiteral Literal>
+class KmpFixedPattern {
+public:
+    static constexpr std::size_t max_unrolled_size = 16;
+    static constexpr std::size_t max_dfa_size = 254;
+
+    /* Get the pattern. */
+    static constexpr std::string_view pattern()
+    {
+        return {Literal.chars, pattern_size};
+    }
+
+    /* Find the first occurrence of the pattern; npos if there is none. */
+    static constexpr std::size_t find(std::string_view str)
+    {
+        if constexpr (pattern_size == 0) {
+            return 0;
+        } else if constexpr (pattern_size <= max_unrolled_size) {
+            for (std::size_t i = 0; i + pattern_size <= str.size(); ++i) {
+                i = str.find(Literal.chars[0], i);
+                if (i == std::string_view::npos || i + pattern_size > str.size())
+                    break;
+                if (matches_at(str.data() + i))
+                    return i;
+            }
+            return std::string_view::npos;
+        } else if constexpr (pattern_size <= max_dfa_size) {
+            std::uint8_t state = 0;
+            for (std::size_t i = 0; i < str.size(); ++i) {
+                if (state == 0 && (i = str.find(Literal.chars[0], i)) == std::string_view::npos)
+                    break;
+                state = dfa[state * 256 + static_cast<unsigned char>(str[i])];
+                if (state == pattern_size)
+                    return i + 1 - pattern_size;
+            }
+            return std::string_view::npos;
+        } else {
+            auto [end_it, match_len] = kmp_resume_pattern_raw(str.begin(), str.end(), Literal.chars,
+                    lps.begin(), pattern_size, std::size_t(0));
+            return match_len == pattern_size ? end_it - str.begin() - match_len : std::string_view::npos;
+        }
+    }
+
+    /* Count all (possibly overlapping) occurrences of the pattern. */
+    static constexpr std::size_t count(std::string_view str)
+    {
+        std::size_t nr_matches = 0;
+        if constexpr (pattern_size == 0) {
+            return 0;
+        } else if constexpr (pattern_size <= max_unrolled_size) {
+            for (std::size_t i = 0; i + pattern_size <= str.size(); ++i) {
+                i = str.find(Literal.chars[0], i);
+                if (i == std::string_view::npos || i + pattern_size > str.size())
+                    break;
+                nr_matches += matches_at(str.data() + i);
+            }
+        } else if constexpr (pattern_size <= max_dfa_size) {
+            std::uint8_t state = 0;
+            for (std::size_t i = 0; i < str.size(); ++i) {
+                if (state == 0 && (i = str.find(Literal.chars[0], i)) == std::string_view::npos)
+                    break;
+                state = dfa[state * 256 + static_cast<unsigned char>(str[i])];
+                nr_matches += state == pattern_size;
+            }
+        } else {
+            for (std::size_t from = 0, j = 0;;) {
+                auto [end_it, match_len] = kmp_resume_pattern_raw(str.begin() + from, str.end(), Literal.chars,
+                        lps.begin(), pattern_size, j);
+                if (match_len < pattern_size)
+                    break;
+                ++nr_matches;
+                from = end_it - str.begin();
+                j = lps[pattern_size - 1];
+            }
+        }
+        return nr_matches;
+    }
+
+private:
+    static constexpr std::size_t pattern_size = Literal.size();
+
+    /* Compare the pattern with the text at the position, unrolled over the pattern's characters. */
+    static constexpr bool matches_at(const char *s)
+    {
+        return [s]<std::size_t... I>(std::index_sequence<I...>)
+        {
+            return ((s[I] == Literal.chars[I]) && ...);
+        }(std::make_index_sequence<pattern_size>());
+    }
+
+    static constexpr std::array<std::size_t, pattern_size> lps = []
+    {
+        std::array<std::size_t, pattern_size> lps {};
+        build_lps(Literal.chars, lps.begin(), pattern_size);
+        return lps;
+    }();
+
+    /* Transition table of the KMP automaton, as in KmpDfa but with state indices; only for mid-sized patterns. */
+    static constexpr auto dfa = []
+    {
+        constexpr bool use_dfa = pattern_size > max_unrolled_size && pattern_size <= max_dfa_size;
+        std::array<std::uint8_t, use_dfa ? (pattern_size + 1) * 256 : 0> table {};
+        if constexpr (use_dfa) {
+            for (std::size_t j = 0; j <= pattern_size; ++j) {
+                if (j > 0)
+                    for (std::size_t c = 0; c < 256; ++c)
+                        table[j * 256 + c] = table[lps[j - 1] * 256 + c];
+                if (j < pattern_size)
+                    table[j * 256 + static_cast<unsigned char>(Literal.chars[j])] = static_cast<std::uint8_t>(j + 1);
+            }
+        }
+        return table;
+    }();
+};
+
+
+/* Instruction set levels of the vectorized substring search. */
+enum class SimdLevel {
+    Scalar, SSE2, AVX2, AVX512
+};
+
+
+/* Detect the best instruction set level the CPU supports. */
+SimdLevel detect_simd_level();
+
+/* Vectorized substring search using the first-and-last-byte filter, dispatched at runtime
+ * to the best instruction set level the CPU supports. When candidate verification gets too expensive
+ * (highly repetitive inputs), it falls back to KMP, so the running time stays linear. */
+std::size_t fast_str_find(std::string_view str, std::string_view pat);
+
+/* Vectorized substring search at the given instruction set level, which the CPU must support. */
+std::size_t fast_str_find(std::string_view str, std::string_view pat, SimdLevel level);
+
+/* Vectorized substring search that ignores the case of ASCII letters; the text's bytes are folded in the registers,
+ * so it runs at nearly the speed of the case-sensitive search. */
+std::size_t fast_str_find_icase(std::string_view str, std::string_view pat);
+
+/* Case-insensitive vectorized substring search at the given instruction set level. */
+std::size_t fast_str_find_icase(std::string_view str, std::string_view pat, SimdLevel level);
+
+/* Substring search in UTF-8 text that only reports matches starting and ending at code point boundaries,
+ * so a pattern that starts or ends in the middle of a multi-byte sequence never matches inside another character. */
+std::size_t utf8_str_find(std::string_view str, std::string_view pat);
+
+
+/* Substring search backends that str_find chooses from. */
+enum class StrFindBackend {
+    Simd, Horspool, TwoWay
+};
+
+/* Get the name of the backend. */
+const char *to_string(StrFindBackend backend);
+
+/* Pick the backend that is expected to be the fastest for the pattern, by its size m and by the number d
+ * of distinct characters in it, which estimates the alphabet. The vectorized search is picked for short patterns
+ * and while its candidates are rare enough for their verification to be cheap (m <= d * d), otherwise Horspool if its shifts
+ * are long enough (d >= 4), otherwise Two-Way, which takes O(n + m) time and O(1) space. The KMP DFA is faster
+ * on small alphabets once built, but building its table takes O(256 * m) time and 1 KiB per pattern character,
+ * which a single search of a short text does not pay back; it is meant for compiled patterns searched many times.
+ * The thresholds come from bench_kmp_pattern_search. */
+StrFindBackend select_str_find_backend(std::string_view pat);
+
+/* Find the first occurrence of the pattern with the backend picked by select_str_find_backend. */
+std::size_t str_find(std::string_view str, std::string_view pat);
+
+
+/* KMP automaton compiled from the pattern's lps array into a full transition table over bytes,
+ * so that matching takes one table load per input byte instead of following failure links.
+ * State j means that the last j bytes matched the pattern's prefix of length j;
+ * state size() means a full match, from which the automaton continues to find overlapping matches. */
+class KmpDfa {
+public:
+    explicit KmpDfa(std::string_view pattern);
+
+    /* Get the size of the pattern, which is also the accepting state. */
+    inline std::size_t size() const
+    {
+        return pattern_size;
+    }
+
+    /* Get the next state after reading the byte in the state. */
+    inline std::uint32_t next(std::uint32_t state, unsigned char c) const
+    {
+        return table[state * alphabet_size + c] / alphabet_size;
+    }
+
+    /* Find the first occurrence of the pattern; npos if there is none. */
+    std::size_t find(std::string_view str) const;
+
+    /* Count all (possibly overlapping) occurrences of the pattern. */
+    std::size_t count(std::string_view str) const;
+
+    static constexpr std::size_t alphabet_size = 256;
+
+private:
+    std::size_t pattern_size; /* Size of the pattern. */
+    std::vector<std::uint32_t> table; /* Row-major transition table; entries are pre-multiplied
+                                         by the row size, so they are offsets of the next row. */
+};
+
+
+std::size_t kmp_dfa_str_find(std::string_view str, std::string_view pat);
@@ -0,0 +1,120 @@
+#pragma once
+
+/*
+ * Rabin-Karp multi-pattern search over sets of equal-size patterns
+ * */
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+
+/* Rabin-Karp search for many patterns of the same size: a polynomial hash of every window of the text is rolled
+ * and looked up among the patterns' hashes, and only the windows whose hash matches are compared
+ * with the patterns. Memory is linear in the total size of the patterns, unlike the trie of Aho-Corasick,
+ * and the time is O(n + m * occurrences) expected for any text, as only the occurrences are compared byte by byte.
+ * The rolled hash is taken modulo 2^32 with a random odd base, so rolling it takes one multiplication in plain
+ * wrapping arithmetic. Each block of the text is split into several lanes that roll their hashes in the same loop,
+ * so the lanes' multiplications overlap instead of forming one long dependency chain, and the hashes are then
+ * passed through a byte filter: each entry holds a tag of the hash that falls there, so only about
+ * one window in a few hundred that misses the patterns probes the open-addressing table of hashes.
+ * A hash modulo 2^32 is only a filter, though: whatever the odd base, a Thue-Morse string of 256 bytes or more
+ * collides with its complement, so texts can be built whose windows all pass it. The windows found in the table
+ * are therefore confirmed by a fingerprint modulo the prime 2^61 - 1 with a random base, which two different
+ * windows share with probability at most m / 2^61, before they are compared. The fingerprint is rolled only from
+ * one candidate to the next, or computed from scratch when they are m or more bytes apart, which takes O(n)
+ * in the worst case and next to nothing when the candidates are rare. */
+class RabinKarp {
+public:
+    struct Match {
+        std::size_t pattern_id; // index of the pattern in the list it was built from
+        std::size_t offset; // offset of the first byte of the match in the text
+    };
+
+    /* Build the fingerprint set from non-empty patterns of the same size. */
+    explicit RabinKarp(const std::vector<std::string_view>& patterns);
+
+    /* Get the number of patterns. */
+    inline std::size_t size() const
+    {
+        return nr_patterns;
+    }
+
+    /* Get the size of each pattern. */
+    inline std::size_t pattern_size() const
+    {
+        return m;
+    }
+
+    /* Scan the text and call on_match(pattern_id, offset) for every occurrence of every pattern,
+     * in the order of the occurrences. */
+    template<typename OnMatch>
+    void scan(std::string_view text, OnMatch&& on_match) const
+    {
+        if (nr_patterns == 0 || text.size() < m)
+            return;
+        std::vector<std::uint32_t> hashes;
+        std::vector<Candidate> candidates;
+        const std::size_t nr_positions = text.size() - m + 1, block_size = nr_lanes * lane_size();
+        for (std::size_t begin = 0; begin < nr_positions; begin += block_size) {
+            collect_candidates(text, begin, std::min(nr_positions, begin + block_size), hashes, candidates);
+            for (const Candidate& candidate : candidates) {
+                const std::uint32_t first = slot_first[candidate.slot], last = first + slot_count[candidate.slot];
+                for (std::uint32_t k = first; k < last; ++k)
+                    if (fingerprints[k] == candidate.fingerprint
+                            && std::memcmp(text.data() + candidate.offset, patterns.data() + ids[k] * m, m) == 0)
+                        on_match(std::size_t(ids[k]), candidate.offset);
+            }
+        }
+    }
+
+    /* Find all occurrences of all patterns. */
+    std::vector<Match> find_all(std::string_view text) const;
+
+    /* Count all occurrences of all patterns. */
+    std::size_t count(std::string_view text) const;
+
+private:
+    /* Window whose hash is in the table. */
+    struct Candidate {
+        std::size_t offset;
+        std::uint32_t slot;
+        std::uint64_t fingerprint; /* Fingerprint modulo 2^61 - 1 of the window. */
+    };
+
+    static constexpr std::size_t nr_lanes = 4;
+
+    /* Get the number of window positions a lane covers in a block; each lane hashes its first window
+     * from scratch, so the lanes are kept much longer than the patterns. */
+    inline std::size_t lane_size() const
+    {
+        return std::max<std::size_t>(1024, 8 * m);
+    }
+
+    /* Get the table slot of the hash, or -1 if it is not there. */
+    std::int64_t find_slot(std::uint32_t hash) const;
+
+    /* Collect the windows at the positions [begin, end) whose hashes are in the table, in increasing order,
+     * with their fingerprints; hashes is the scratch buffer for the windows' hashes. */
+    void collect_candidates(std::string_view text, std::size_t begin, std::size_t end,
+            std::vector<std::uint32_t>& hashes, std::vector<Candidate>& candidates) const;
+
+    std::size_t m = 0; /* Size of each pattern. */
+    std::size_t nr_patterns = 0;
+    std::string patterns; /* The patterns, back to back. */
+    std::uint32_t base; /* Base of the polynomial hash. */
+    std::uint32_t remove_term[256]; /* -c * base^(m-1): takes the outgoing byte c off a window's hash. */
+    std::uint64_t fingerprint_base; /* Base of the fingerprint modulo 2^61 - 1. */
+    std::uint64_t fingerprint_remove_term[256]; /* -c * fingerprint_base^(m-1) modulo 2^61 - 1. */
+    std::vector<std::uint8_t> filter; /* Tag of the hash falling in each range of the hash values. */
+    std::vector<std::uint32_t> slot_hash; /* Hash in each slot of the table. */
+    unsigned slot_shift; /* 32 minus the log2 of the number of slots. */
+    std::vector<std::uint32_t> slot_first, slot_count; /* Range of ids of the patterns with each hash;
+                                                          slots with no ids are empty. */
+    std::vector<std::uint32_t> ids; /* Ids of the patterns, grouped by slot. */
+    std::vector<std::uint64_t> fingerprints; /* Fingerprints of the patterns, in the order of ids. */
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+/*
+ * String structure: Z-array, periods, border tree and runs, plus batched queries over many short strings
+ * */
+
+#include "kmp_pattern_search.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <vector>
+
+
+/* Build the Z-array, where z[i] is the length of the longest common prefix of the string and its suffix at i;
+ * z[0] is the size of the string. */
+template<std::random_access_iterator StrIt, std::random_access_iterator ZIt,
+    typename Size = std::iter_value_t<ZIt>,
+    typename ChrEqual = std::equal_to<std::iter_value_t<StrIt>>,
+    typename = std::enable_if_t<std::is_integral_v<std::iter_value_t<ZIt>>>>
+constexpr void build_z_array(StrIt str, ZIt z, Size size, const ChrEqual& chr_equal = ChrEqual())
+{
+    if (size == 0)
+        return;
+    z[0] = size;
+    // [l, r) is the rightmost segment found so far that matches a prefix of the string
+    Size l = 0, r = 0;
+    for (Size i = 1; i < size; ++i) {
+        Size len = 0;
+        if (i < r)
+            len = z[i - l] < r - i ? z[i - l] : r - i;
+        while (i + len < size && chr_equal(str[len], str[i + len]))
+            ++len;
+        z[i] = len;
+        if (i + len > r) {
+            l = i;
+            r = i + len;
+        }
+    }
+}
+
+/* Build the Z-array of the string. */
+std::vector<std::uint32_t> build_z_array(std::string_view str);
+
+/* Build the lps array (the prefix function) of the string. */
+std::vector<std::uint32_t> build_lps(std::string_view str);
+
+/* The largest alphabet for which build_lps_small_alphabet uses the automaton. */
+constexpr std::size_t max_small_alphabet = 16;
+
+/* Build the lps array from the prefix-function automaton: row j holds the transitions from the state
+ * where j characters are matched, and is a copy of the row of state lps[j - 1] with one transition changed.
+ * Each character then takes a single table lookup instead of a data-dependent loop over the borders,
+ * and the row copies are short fixed-size block moves that the compiler vectorizes. The table takes
+ * size * alphabet * 4 bytes, so it suits strings over small alphabets such as DNA that are short enough
+ * for the table to stay in the caches; other strings are handled by build_lps instead. */
+std::vector<std::uint32_t> build_lps_small_alphabet(std::string_view str);
+
+
+/* Get the shortest period of the string: the smallest p > 0 with str[i] == str[i + p] for all valid i.
+ * The period of an empty string is 0. */
+std::size_t shortest_period(std::string_view str);
+
+/* Get all periods of the string in increasing order, the size of the string being the last one.
+ * They are the size minus the lengths of the borders, which are found by following the lps chain. */
+std::vector<std::size_t> all_periods(std::string_view str);
+
+
+/* Border tree (failure tree) of a string: node i stands for the prefix of size i, and its parent is
+ * the prefix's longest proper border lps[i - 1], so the ancestors of a node are exactly the borders of the prefix.
+ * The nodes get DFS entry and exit times, which answer whether one prefix is a border of another in O(1),
+ * and jump pointers, which answer the longest common border of two prefixes in O(log n) with O(n) memory. */
+class BorderTree {
+public:
+    explicit BorderTree(std::string_view str);
+
+    /* Get the number of nodes: the size of the string plus one for the empty prefix. */
+    inline std::size_t size() const
+    {
+        return parent_.size();
+    }
+
+    /* Get the size of the longest proper border of the prefix of size i (i > 0). */
+    inline std::uint32_t parent(std::size_t i) const
+    {
+        return parent_[i];
+    }
+
+    /* Get the number of non-empty borders of the prefix of size i, counting the prefix itself. */
+    inline std::uint32_t depth(std::size_t i) const
+    {
+        return depth_[i];
+    }
+
+    /* Check whether the prefix of size k is a border of the prefix of size i (every prefix is its own border). */
+    inline bool is_border(std::size_t k, std::size_t i) const
+    {
+        return entry_time[k] <= entry_time[i] && entry_time[i] < exit_time[k];
+    }
+
+    /* Get the size of the longest common border of the prefixes of sizes i and j. */
+    std::size_t longest_common_border(std::size_t i, std::size_t j) const;
+
+private:
+    /* Get the ancestor of the node i at the given depth (not greater than the node's). */
+    std::size_t ancestor(std::size_t i, std::uint32_t depth) const;
+
+    std::vector<std::uint32_t> parent_, depth_;
+    std::vector<std::uint32_t> jump; /* Ancestors at skew-binary distances, for the logarithmic ascents. */
+    std::vector<std::uint32_t> entry_time, exit_time; /* Preorder DFS times; the subtree of i is [entry, exit). */
+};
+
+
+/* Run (maximal repetition): str[start, end) has the smallest period `period`, is at least twice as long,
+ * and cannot be extended by a character on either side with the same period. */
+struct StringRun {
+    std::size_t start, end, period;
+
+    friend bool operator==(const StringRun&, const StringRun&) = default;
+};
+
+/* Find all runs of the string, ordered by their start and then by their end, in linear time.
+ * A string has fewer runs than characters, and every run's Lyndon root is the longest Lyndon word starting
+ * at its position for either the lexicographic or the reversed alphabet order (Bannai et al.'s runs theorem).
+ * So the Lyndon arrays for both orders give at most 2n candidate periods, computed as next smaller values
+ * of the suffix ranks, and each candidate is extended both ways with O(1) longest common extension queries
+ * on the suffix arrays of the string and of its reversal. */
+std::vector<StringRun> find_runs(std::string_view str);
+
+
+/* Many short strings stored back to back in one buffer: string k is data[offsets[k], offsets[k + 1]).
+ * The batch functions write their results into caller-provided arrays laid out the same way as the data,
+ * so no memory is allocated per string; values are relative to the string's own start. */
+struct StringBatch {
+    std::string_view data;
+    std::span<const std::size_t> offsets; /* One more offset than strings, the last one being the data's size. */
+
+    inline std::size_t size() const
+    {
+        return offsets.empty() ? 0 : offsets.size() - 1;
+    }
+
+    inline std::string_view operator[](std::size_t k) const
+    {
+        return data.substr(offsets[k], offsets[k + 1] - offsets[k]);
+    }
+};
+
+/* Build the lps arrays of all strings of the batch into lps, which has the size of the data.
+ * If the whole batch has a small alphabet, the strings share one prefix-function automaton table. */
+void batch_build_lps(const StringBatch& batch, std::span<std::uint32_t> lps);
+
+/* Build the Z-arrays of all strings of the batch into z, which has the size of the data. */
+void batch_build_z_array(const StringBatch& batch, std::span<std::uint32_t> z);
+
+/* Get the shortest periods of all strings of the batch into periods, which has one element per string.
+ * A string is a repetition of a shorter record exactly when its period is smaller than and divides its size.
+ * The lps arrays are built in one scratch buffer the size of the longest string. */
+void batch_shortest_periods(const StringBatch& batch, std::span<std::uint32_t> periods);
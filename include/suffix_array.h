@@ -0,0 +1,83 @@
+#pragma once
+
+/*
+ * Suffix array index: SA-IS construction, LCP array and pattern search over a static text
+ * */
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+
+/* Build the suffix array of the text with the SA-IS algorithm (induced sorting), in linear time. */
+std::vector<std::uint64_t> build_suffix_array(std::string_view text);
+
+/* Build the LCP array, where lcp[i] is the length of the longest common prefix of the suffixes
+ * sa[i - 1] and sa[i] (lcp[0] is 0), with Kasai's algorithm. The text positions are split between threads,
+ * each starting Kasai's running prefix length from zero; 0 threads means the hardware concurrency. */
+std::vector<std::uint64_t> build_lcp_array(std::string_view text, std::span<const std::uint64_t> sa,
+        unsigned nr_threads = 0);
+
+
+/* Suffix array index of a static text, which answers count and locate queries for a pattern without scanning
+ * the text: the range of suffixes starting with the pattern is found by the binary search of Manber and Myers,
+ * in O(m + log n) time. Each step of the search has a fixed pair of bounds, and the longest common prefixes
+ * of its middle suffix with both of them are precomputed from the LCP array, so a step either decides
+ * without reading the text or resumes comparing the pattern where the closer bound stopped matching it.
+ * Thus no character of the pattern is compared twice after a match, unlike with the mlr heuristic alone,
+ * which only skips the characters shared by both bounds and is O(m log n) in the worst case.
+ * The index can be saved to a file that holds the text, the suffix array and the two precomputed LCP arrays,
+ * and loaded from it by memory-mapping the file where it is supported (UNIX), so loading takes no time and memory
+ * for copies; elsewhere the file is read into memory. */
+class SuffixArray {
+public:
+    /* Build the index of the text. */
+    explicit SuffixArray(std::string text, unsigned nr_threads = 0);
+
+    /* Load the index saved by save() by memory-mapping the file. */
+    static SuffixArray load(const std::string& path);
+
+    /* Save the index to the file. */
+    void save(const std::string& path) const;
+
+    inline std::size_t size() const
+    {
+        return text_view.size();
+    }
+
+    inline std::string_view text() const
+    {
+        return text_view;
+    }
+
+    inline std::span<const std::uint64_t> suffix_array() const
+    {
+        return sa;
+    }
+
+    /* Get the range [first, last) of the suffix array where the suffixes start with the pattern. */
+    std::pair<std::size_t, std::size_t> find_range(std::string_view pat) const;
+
+    /* Count the occurrences of the pattern. */
+    std::size_t count(std::string_view pat) const;
+
+    /* Get the positions of all occurrences of the pattern in increasing order. */
+    std::vector<std::size_t> locate(std::string_view pat) const;
+
+private:
+    struct Storage;
+    class Mapping;
+
+    SuffixArray() = default;
+
+    std::shared_ptr<const void> storage; /* Storage of a built index, or the mapping of a loaded one. */
+    std::string_view text_view;
+    std::span<const std::uint64_t> sa;
+    std::span<const std::uint64_t> lcp_left; /* LCP of the suffix in the middle of a search step with its lower bound. */
+    std::span<const std::uint64_t> lcp_right; /* LCP of the suffix in the middle of a search step with its upper bound. */
+};
@@ -1,38 +1,80 @@
 #pragma once
 
+#include <atomic>
 #include <utility>
 #include <vector>
 #include <concepts>
+#include <cstdint>
+#include <random>
+#include <type_traits>
 
-template<std::integral Index = int>
+/* How the compressing find shortens the path it walks to the root, in the same single pass:
+ * path halving points every other node on the path at its grandparent and skips to it,
+ * path splitting points every node on the path at its grandparent. */
+enum class UnionFindCompression { Halving, Splitting };
+
+/* Which root becomes the parent when two sets are merged: the root of the larger set or of the higher tree. */
+enum class UnionFindLinking { BySize, ByRank };
+
+/* Disjoint-set forest over the elements 0..size()-1. Each node keeps its parent and the weight of its subtree
+ * (its size or rank, which is only meaningful at the roots) side by side, so a step of a find or a link touches
+ * one cache line instead of one in each of two arrays. Union by size or rank together with either kind of
+ * compression keeps the amortized cost of the operations at the inverse Ackermann function of the size,
+ * and neither kind needs a second pass or recursion. */
+template<std::integral Index = int, UnionFindLinking linking = UnionFindLinking::BySize,
+         UnionFindCompression compression = UnionFindCompression::Halving>
 class UnionFind {
 public:
     explicit UnionFind(std::size_t size = 0)
-        : parent(size), rank(size, 1)
     {
-        for (std::size_t i = 0; i < size; ++i)
-            parent[i] = static_cast<Index>(i);
+        resize(size);
     }
 
+    /* Find the root of the set of p without modifying the forest. */
     Index find(Index p) const
     {
-        while (p != parent[p])
-            p = parent[p];
+        while (p != nodes[p].parent)
+            p = nodes[p].parent;
         return p;
     }
 
+    /* Find the root of the set of p and compress the path to it. Nodes already pointing at the root
+     * are left untouched, so finds on shallow trees do not dirty their cache lines. */
     Index find(Index p)
     {
-        return parent[p] = std::as_const(*this).find(p);
+        for (;;) {
+            const Index parent = nodes[p].parent;
+            const Index grandparent = nodes[parent].parent;
+            if (parent == grandparent)
+                return parent;
+            nodes[p].parent = grandparent;
+            if constexpr (compression == UnionFindCompression::Halving)
+                p = grandparent;
+            else
+                p = parent;
+        }
+    }
+
+    /* Get the parent of p in the forest; roots are their own parents. */
+    inline Index parent(Index p) const
+    {
+        return nodes[p].parent;
     }
 
-    void merge(Index x, Index y)
+    /* Merge the sets of x and y. Return false if they already were the same set. */
+    bool merge(Index x, Index y)
     {
         x = find(x); y = find(y);
-        if (rank[x] < rank[y])
+        if (x == y)
+            return false;
+        if (nodes[x].weight < nodes[y].weight)
             std::swap(x, y);
-        rank[y] = rank[x] += !!(rank[x] == rank[y]);
-        parent[y] = parent[x] = x;
+        nodes[y].parent = x;
+        if constexpr (linking == UnionFindLinking::BySize)
+            nodes[x].weight += nodes[y].weight;
+        else
+            nodes[x].weight += !!(nodes[x].weight == nodes[y].weight);
+        return true;
     }
 
     inline bool connected(Index x, Index y) const
@@ -40,22 +82,140 @@ public:
         return find(x) == find(y);
     }
 
+    inline bool connected(Index x, Index y)
+    {
+        return find(x) == find(y);
+    }
+
+    /* Get the number of elements in the set of p. */
+    inline std::size_t set_size(Index p) const requires (linking == UnionFindLinking::BySize)
+    {
+        return static_cast<std::size_t>(nodes[find(p)].weight);
+    }
+
     inline std::size_t size() const
     {
-        return parent.size();
+        return nodes.size();
     }
 
     void resize(std::size_t size)
     {
-        const std::size_t prev_size = parent.size();
-        parent.resize(size);
-        rank.resize(size);
-        for (std::size_t i = prev_size; i < size; ++i) {
-            parent[i] = static_cast<Index>(i);
-            rank[i] = 1;
+        const std::size_t prev_size = nodes.size();
+        nodes.resize(size);
+        for (std::size_t i = prev_size; i < size; ++i)
+            nodes[i] = {static_cast<Index>(i), 1};
+    }
+
+private:
+    /* Aligned to its size, so a node never straddles two cache lines. */
+    struct alignas(2 * sizeof(Index)) Node {
+        Index parent;
+        Index weight; /* Size or rank of the subtree. */
+    };
+
+    std::vector<Node> nodes;
+};
+
+
+/* Which root becomes the child when two sets are merged concurrently: the one with the larger index,
+ * or the one later in a random order of the elements fixed at construction. */
+enum class ConcurrentUnionFindLinking { ByIndex, ByRandomIndex };
+
+/* Disjoint-set forest whose operations may be called from many threads at once, after the Jayanti-Tarjan
+ * randomized concurrent union-find. The parent links are atomics, and a root is linked under another root
+ * with one compare-and-swap that fails if it stopped being a root in between, in which case the merge
+ * retries from the new roots. Linking follows a strict order of the elements, so no cycle can ever form:
+ * linking by index keeps the smaller index of a set at its root, which makes the roots the minimum elements
+ * of their sets; linking by random index bounds the expected height of the trees by O(log n) whatever
+ * the order of the merges. Finds compress by path halving, each step with a single relaxed compare-and-swap
+ * that is simply dropped when it loses a race: links only ever move up the tree, so any value read or
+ * written is an ancestor, and finds are lock-free and never wait for each other.
+ * Relaxed memory ordering is enough for the forest itself, since every decision is made by a read-modify-write
+ * of a single link; joining the threads orders the results for the readers. */
+template<std::integral Index = int, ConcurrentUnionFindLinking linking = ConcurrentUnionFindLinking::ByIndex>
+class ConcurrentUnionFind {
+public:
+    /* Make size singletons; the size is fixed, as growing the array cannot be done concurrently. */
+    explicit ConcurrentUnionFind(std::size_t size = 0)
+        : parents(size)
+    {
+        for (std::size_t i = 0; i < size; ++i)
+            parents[i].store(static_cast<Index>(i), std::memory_order_relaxed);
+        if constexpr (linking == ConcurrentUnionFindLinking::ByRandomIndex)
+            seed = static_cast<Unsigned>(std::random_device()());
+    }
+
+    /* Find the root of the set of p and halve the path to it. While other threads merge, the result
+     * may stop being a root as soon as it is returned. */
+    Index find(Index p)
+    {
+        for (;;) {
+            Index parent = parents[p].load(std::memory_order_relaxed);
+            const Index grandparent = parents[parent].load(std::memory_order_relaxed);
+            if (parent == grandparent)
+                return parent;
+            parents[p].compare_exchange_weak(parent, grandparent, std::memory_order_relaxed);
+            p = grandparent;
+        }
+    }
+
+    /* Merge the sets of x and y. Return false if they already were the same set. */
+    bool merge(Index x, Index y)
+    {
+        for (;;) {
+            x = find(x); y = find(y);
+            if (x == y)
+                return false;
+            if (precedes(x, y))
+                std::swap(x, y);
+            Index expected = x;
+            if (parents[x].compare_exchange_strong(expected, y, std::memory_order_relaxed))
+                return true;
         }
     }
 
+    /* Check whether x and y are in the same set. The answer is exact at some moment during the call:
+     * a false one is confirmed by the root of x still being a root after both finds. */
+    bool connected(Index x, Index y)
+    {
+        for (;;) {
+            x = find(x); y = find(y);
+            if (x == y)
+                return true;
+            if (parents[x].load(std::memory_order_relaxed) == x)
+                return false;
+        }
+    }
+
+    /* Get the parent of p in the forest; roots are their own parents. */
+    inline Index parent(Index p) const
+    {
+        return parents[p].load(std::memory_order_relaxed);
+    }
+
+    inline std::size_t size() const
+    {
+        return parents.size();
+    }
+
 private:
-    std::vector<Index> parent, rank;
+    using Unsigned = std::make_unsigned_t<Index>;
+
+    /* Check whether x comes before y in the linking order, that is whether y is to be linked under x. */
+    inline bool precedes(Index x, Index y) const
+    {
+        if constexpr (linking == ConcurrentUnionFindLinking::ByIndex)
+            return x < y;
+        else
+            return priority(x) < priority(y);
+    }
+
+    /* Position of p in the random order: a bijection of the indices mixed with the seed. */
+    inline Unsigned priority(Index p) const
+    {
+        return static_cast<Unsigned>(std::uint64_t(static_cast<Unsigned>(p) ^ seed) * 0x9E3779B97F4A7C15u);
+    }
+
+    std::vector<std::atomic<Index>> parents;
+    Unsigned seed = 0;
 };
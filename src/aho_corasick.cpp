@@ -0,0 +1,84 @@
+#include "aho_corasick.h"
+
+#include "error.h"
+
+
+AhoCorasick::AhoCorasick(const std::vector<std::string_view>& patterns)
+{
+    for (std::string_view pattern : patterns)
+        for (unsigned char c : pattern)
+            if (!byte_class[c])
+                byte_class[c] = static_cast<std::uint16_t>(nr_classes++);
+
+    // build the trie, absent edges are marked as 0 since the root is nobody's child
+    transitions.assign(nr_classes, 0);
+    std::vector<std::vector<std::uint32_t>> ids_by_state (1);
+    pattern_sizes.reserve(patterns.size());
+    for (std::size_t id = 0; id < patterns.size(); ++id) {
+        if (patterns[id].empty())
+            throw Error<AhoCorasick>("Patterns must not be empty");
+        pattern_sizes.push_back(patterns[id].size());
+
+        std::uint32_t state = 0;
+        for (unsigned char c : patterns[id]) {
+            std::uint32_t& next = transitions[state * nr_classes + byte_class[c]];
+            if (!next) {
+                next = static_cast<std::uint32_t>(ids_by_state.size());
+                ids_by_state.emplace_back();
+                transitions.resize(transitions.size() + nr_classes, 0);
+            }
+            state = transitions[state * nr_classes + byte_class[c]];
+        }
+        ids_by_state[state].push_back(static_cast<std::uint32_t>(id));
+    }
+
+    const std::size_t nr_states = ids_by_state.size();
+    first_output.reserve(nr_states + 1);
+    for (const auto& ids : ids_by_state) {
+        first_output.push_back(static_cast<std::uint32_t>(output_ids.size()));
+        output_ids.insert(output_ids.end(), ids.begin(), ids.end());
+    }
+    first_output.push_back(static_cast<std::uint32_t>(output_ids.size()));
+
+    // breadth-first, complete the missing transitions through the failure links, as KMP's build_lps does
+    std::vector<std::uint32_t> fail (nr_states, 0), queue;
+    queue.reserve(nr_states);
+    first_report.assign(nr_states, 0);
+    next_report.assign(nr_states, 0);
+    for (std::size_t c = 0; c < nr_classes; ++c)
+        if (transitions[c])
+            queue.push_back(transitions[c]);
+    for (std::size_t head = 0; head < queue.size(); ++head) {
+        const std::uint32_t state = queue[head];
+        next_report[state] = first_report[fail[state]];
+        first_report[state] = first_output[state] < first_output[state + 1] ? state : next_report[state];
+
+        std::uint32_t *const row = transitions.data() + state * nr_classes;
+        const std::uint32_t *const fail_row = transitions.data() + fail[state] * nr_classes;
+        for (std::size_t c = 0; c < nr_classes; ++c) {
+            if (row[c]) {
+                fail[row[c]] = fail_row[c];
+                queue.push_back(row[c]);
+            } else {
+                row[c] = fail_row[c];
+            }
+        }
+    }
+}
+
+std::vector<AhoCorasick::Match> AhoCorasick::find_all(std::string_view text) const
+{
+    std::vector<Match> matches;
+    scan(text, [&matches](std::size_t pattern_id, std::size_t offset)
+            {
+                matches.push_back({pattern_id, offset});
+            });
+    return matches;
+}
+
+std::size_t AhoCorasick::count(std::string_view text) const
+{
+    std::size_t nr_matches = 0;
+    scan(text, [&nr_matches](std::size_t, std::size_t) { ++nr_matches; });
+    return nr_matches;
+}
@@ -0,0 +1,20 @@
+#include "ans_coding.h"
+
+
+template class AnsModel<char>;
+template class AnsModel<unsigned char>;
+
+template class RansEncoder<char>;
+template class RansEncoder<unsigned char>;
+
+template class RansDecoder<char>;
+template class RansDecoder<unsigned char>;
+
+template class TansTable<char>;
+template class TansTable<unsigned char>;
+
+template class TansEncoder<char>;
+template class TansEncoder<unsigned char>;
+
+template class TansDecoder<char>;
+template class TansDecoder<unsigned char>;
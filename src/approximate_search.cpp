@@ -0,0 +1,33 @@
+#include "approximate_search.h"
+
+#include "error.h"
+
+
+/* Build the bit vectors of the positions of each byte in the pattern. */
+static std::vector<std::uint64_t> build_masks(std::string_view pattern, std::size_t nr_words)
+{
+    std::vector<std::uint64_t> masks (256 * nr_words, 0);
+    for (std::size_t i = 0; i < pattern.size(); ++i)
+        masks[static_cast<unsigned char>(pattern[i]) * nr_words + i / 64] |= std::uint64_t(1) << (i % 64);
+    return masks;
+}
+
+
+BitapPattern::BitapPattern(std::string_view pattern, unsigned max_errors)
+    : pattern_size(pattern.size()), max_errors(max_errors), nr_words((pattern.size() + 63) / 64),
+      last_bit(std::uint64_t(1) << ((pattern.size() + 63) % 64))
+{
+    if (max_errors >= pattern_size)
+        throw Error<BitapPattern>("The number of errors must be less than the pattern size");
+    masks = build_masks(pattern, nr_words);
+}
+
+
+MyersPattern::MyersPattern(std::string_view pattern, unsigned max_errors)
+    : pattern_size(pattern.size()), max_errors(max_errors), nr_words((pattern.size() + 63) / 64),
+      last_bit(std::uint64_t(1) << ((pattern.size() + 63) % 64))
+{
+    if (max_errors >= pattern_size)
+        throw Error<MyersPattern>("The number of errors must be less than the pattern size");
+    masks = build_masks(pattern, nr_words);
+}
@@ -0,0 +1,282 @@
+#include "connected_components.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <thread>
+#include <unordered_map>
+
+#include "error.h"
+#include "union_find.h"
+
+
+using Forest = ConcurrentUnionFind<std::uint32_t, ConcurrentUnionFindLinking::ByIndex>;
+
+/* Number of vertices in a block of work; a multiple of 64, so that the threads fill separate words of the bitmaps. */
+static constexpr std::size_t vertex_block_size = 1 << 14;
+/* Number of edges in a block of work. */
+static constexpr std::size_t edge_block_size = 1 << 16;
+/* Number of edges per vertex merged before looking for the giant component. */
+static constexpr std::size_t sample_edges_per_vertex = 2;
+/* Number of vertices whose roots are sampled to find the giant component. */
+static constexpr std::size_t nr_root_samples = 1024;
+
+
+static unsigned resolve_nr_threads(unsigned nr_threads, std::size_t nr_blocks)
+{
+    if (nr_threads == 0)
+        nr_threads = std::max(1u, std::thread::hardware_concurrency());
+    return static_cast<unsigned>(std::clamp<std::size_t>(nr_blocks, 1, nr_threads));
+}
+
+/* Run function(block, begin, end) on the blocks of block_size items of [0, size), which the threads take
+ * one by one, so that blocks of uneven cost are balanced; the first thread is the calling one. */
+template<typename Function>
+static void parallel_blocks(unsigned nr_threads, std::size_t size, std::size_t block_size, Function&& function)
+{
+    const std::size_t nr_blocks = (size + block_size - 1) / block_size;
+    std::atomic<std::size_t> next_block = 0;
+    auto worker = [&]
+    {
+        for (std::size_t block; (block = next_block.fetch_add(1, std::memory_order_relaxed)) < nr_blocks;)
+            function(block, block * block_size, std::min(size, (block + 1) * block_size));
+    };
+    std::vector<std::jthread> threads;
+    for (unsigned t = 1; t < std::min<std::size_t>(nr_threads, nr_blocks); ++t)
+        threads.emplace_back(worker);
+    worker();
+}
+
+static inline bool test_bit(const std::vector<std::uint64_t>& bits, std::uint32_t i)
+{
+    return bits[i >> 6] >> (i & 63) & 1;
+}
+
+/* Point the vertices at their roots (up to the halving of the paths) in the forest with no merges running. */
+static void flatten(Forest& forest, unsigned nr_threads)
+{
+    parallel_blocks(nr_threads, forest.size(), vertex_block_size, [&forest](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t v = begin; v < end; ++v)
+                    forest.find(static_cast<std::uint32_t>(v));
+            });
+}
+
+/* Find the most frequent root among a fixed sample of the vertices, and mark the vertices under it;
+ * finding their roots flattens the forest. */
+static std::vector<std::uint64_t> mark_giant_component(Forest& forest, std::uint32_t& giant, unsigned nr_threads)
+{
+    const std::size_t n = forest.size();
+    if (n == 0)
+        return {};
+    std::unordered_map<std::uint32_t, std::size_t> frequency;
+    std::uint64_t state = 0;
+    for (std::size_t i = 0; i < nr_root_samples; ++i) {
+        state = state * 6364136223846793005u + 1442695040888963407u;
+        const std::uint32_t root = forest.find(static_cast<std::uint32_t>((state >> 32) * n >> 32));
+        const std::size_t count = ++frequency[root];
+        if (count > frequency[giant] || (count == frequency[giant] && root < giant))
+            giant = root;
+    }
+
+    std::vector<std::uint64_t> marks ((n + 63) / 64);
+    parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t v = begin; v < end; ++v)
+                    marks[v >> 6] |= std::uint64_t(forest.find(static_cast<std::uint32_t>(v)) == giant) << (v & 63);
+            });
+    return marks;
+}
+
+/* Number the roots in increasing order, which is the order of the smallest vertices of the components,
+ * as the forest links by index, and label every vertex with the number of its root. The labels hold the roots
+ * until the roots, marked in a bitmap, are replaced by their numbers, which the other vertices then copy. */
+static ConnectedComponents label_components(Forest& forest, unsigned nr_threads)
+{
+    const std::size_t n = forest.size(), nr_blocks = (n + vertex_block_size - 1) / vertex_block_size;
+    ConnectedComponents components;
+    std::vector<std::uint32_t>& labels = components.labels;
+    labels.resize(n);
+    std::vector<std::uint64_t> is_root ((n + 63) / 64);
+    std::vector<std::size_t> block_first (nr_blocks + 1);
+    parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t block, std::size_t begin, std::size_t end)
+            {
+                std::size_t nr_roots = 0;
+                for (std::size_t v = begin; v < end; ++v) {
+                    labels[v] = forest.find(static_cast<std::uint32_t>(v));
+                    is_root[v >> 6] |= std::uint64_t(labels[v] == v) << (v & 63);
+                    nr_roots += labels[v] == v;
+                }
+                block_first[block + 1] = nr_roots;
+            });
+    for (std::size_t block = 0; block < nr_blocks; ++block)
+        block_first[block + 1] += block_first[block];
+    components.count = block_first[nr_blocks];
+
+    parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t block, std::size_t begin, std::size_t end)
+            {
+                std::size_t number = block_first[block];
+                for (std::size_t v = begin; v < end; ++v)
+                    if (test_bit(is_root, static_cast<std::uint32_t>(v)))
+                        labels[v] = static_cast<std::uint32_t>(number++);
+            });
+    parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t v = begin; v < end; ++v)
+                    if (!test_bit(is_root, static_cast<std::uint32_t>(v)))
+                        labels[v] = labels[labels[v]];
+            });
+    return components;
+}
+
+/* Check that the vertices can be numbered by the 32-bit labels. */
+template<typename Type>
+static void check_nr_vertices(std::size_t nr_vertices)
+{
+    if (nr_vertices > std::numeric_limits<std::uint32_t>::max())
+        throw Error<Type>("Too many vertices");
+}
+
+
+CsrGraph build_csr(std::span<const GraphEdge> edges, std::size_t nr_vertices, unsigned nr_threads)
+{
+    check_nr_vertices<CsrGraph>(nr_vertices);
+    nr_threads = resolve_nr_threads(nr_threads, (edges.size() + edge_block_size - 1) / edge_block_size);
+    CsrGraph graph;
+    graph.offsets.assign(nr_vertices + 1, 0);
+    graph.neighbors.resize(2 * edges.size());
+
+    // the counters are only atomic with several threads, as a locked increment costs more than the cache miss
+    auto increment = [nr_threads](std::size_t& counter)
+    {
+        return nr_threads == 1 ? counter++ : std::atomic_ref(counter).fetch_add(1, std::memory_order_relaxed);
+    };
+    std::atomic<bool> out_of_range = false;
+    parallel_blocks(nr_threads, edges.size(), edge_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i) {
+                    const auto [u, v] = edges[i];
+                    if (u >= nr_vertices || v >= nr_vertices) [[unlikely]] {
+                        out_of_range.store(true, std::memory_order_relaxed);
+                        continue;
+                    }
+                    increment(graph.offsets[u + 1]);
+                    increment(graph.offsets[v + 1]);
+                }
+            });
+    if (out_of_range)
+        throw Error<CsrGraph>("Edge endpoint out of range");
+    for (std::size_t v = 0; v < nr_vertices; ++v)
+        graph.offsets[v + 1] += graph.offsets[v];
+
+    std::vector<std::size_t> next (graph.offsets.begin(), graph.offsets.end() - 1);
+    parallel_blocks(nr_threads, edges.size(), edge_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i) {
+                    const auto [u, v] = edges[i];
+                    graph.neighbors[increment(next[u])] = v;
+                    graph.neighbors[increment(next[v])] = u;
+                }
+            });
+    return graph;
+}
+
+ConnectedComponents connected_components(std::span<const GraphEdge> edges, std::size_t nr_vertices,
+        unsigned nr_threads)
+{
+    check_nr_vertices<ConnectedComponents>(nr_vertices);
+    Forest forest (nr_vertices);
+    // every stride-th edge is in the sample; the blocks of work are made of whole strides
+    const std::size_t stride = std::max<std::size_t>(1, edges.size() / (sample_edges_per_vertex * nr_vertices + 1));
+    const std::size_t nr_strides = (edges.size() + stride - 1) / stride;
+    const std::size_t strides_per_block = std::max<std::size_t>(1, edge_block_size / stride);
+    nr_threads = resolve_nr_threads(nr_threads, (nr_strides + strides_per_block - 1) / strides_per_block);
+
+    std::atomic<bool> out_of_range = false;
+    auto for_each_stride = [&](auto&& on_stride)
+    {
+        parallel_blocks(nr_threads, nr_strides, strides_per_block, [&](std::size_t, std::size_t begin, std::size_t end)
+                {
+                    for (std::size_t s = begin; s < end; ++s)
+                        on_stride(edges.subspan(s * stride, std::min(stride, edges.size() - s * stride)));
+                });
+        if (out_of_range)
+            throw Error<ConnectedComponents>("Edge endpoint out of range");
+    };
+    auto in_range = [&](GraphEdge edge)
+    {
+        if (edge.u < nr_vertices && edge.v < nr_vertices) [[likely]]
+            return true;
+        out_of_range.store(true, std::memory_order_relaxed);
+        return false;
+    };
+
+    for_each_stride([&](std::span<const GraphEdge> strided)
+            {
+                if (in_range(strided[0]))
+                    forest.merge(strided[0].u, strided[0].v);
+            });
+    if (stride == 1)
+        return label_components(forest, nr_threads);
+
+    std::uint32_t giant = 0;
+    const std::vector<std::uint64_t> marks = mark_giant_component(forest, giant, nr_threads);
+    for_each_stride([&](std::span<const GraphEdge> strided)
+            {
+                for (GraphEdge edge : strided.subspan(1)) {
+                    if (!in_range(edge))
+                        continue;
+                    const bool u_marked = test_bit(marks, edge.u), v_marked = test_bit(marks, edge.v);
+                    if (!(u_marked && v_marked))
+                        forest.merge(u_marked ? giant : edge.u, v_marked ? giant : edge.v);
+                }
+            });
+    return label_components(forest, nr_threads);
+}
+
+ConnectedComponents connected_components(const CsrGraph& graph, unsigned nr_threads)
+{
+    const std::size_t n = graph.nr_vertices();
+    check_nr_vertices<ConnectedComponents>(n);
+    if (graph.offsets.size() > 0 && graph.offsets.back() != graph.neighbors.size())
+        throw Error<ConnectedComponents>("CSR offsets do not match the neighbors");
+    nr_threads = resolve_nr_threads(nr_threads, (n + vertex_block_size - 1) / vertex_block_size);
+    Forest forest (n);
+
+    std::atomic<bool> out_of_range = false;
+    auto link_neighbors = [&](std::size_t u, std::size_t first, std::size_t last)
+    {
+        for (std::size_t k = first; k < last; ++k) {
+            const std::uint32_t v = graph.neighbors[k];
+            if (v >= n) [[unlikely]]
+                out_of_range.store(true, std::memory_order_relaxed);
+            else
+                forest.merge(static_cast<std::uint32_t>(u), v);
+        }
+    };
+
+    // the neighbor rounds: link each vertex to its first neighbors, which nearly always joins it to the giant component
+    for (std::size_t round = 0; round < sample_edges_per_vertex; ++round) {
+        parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+                {
+                    for (std::size_t u = begin; u < end; ++u)
+                        if (graph.offsets[u] + round < graph.offsets[u + 1])
+                            link_neighbors(u, graph.offsets[u] + round, graph.offsets[u] + round + 1);
+                });
+        if (round + 1 < sample_edges_per_vertex)
+            flatten(forest, nr_threads);
+    }
+
+    std::uint32_t giant = 0;
+    const std::vector<std::uint64_t> marks = mark_giant_component(forest, giant, nr_threads);
+    parallel_blocks(nr_threads, n, vertex_block_size, [&](std::size_t, std::size_t begin, std::size_t end)
+            {
+                for (std::size_t u = begin; u < end; ++u)
+                    if (!test_bit(marks, static_cast<std::uint32_t>(u)))
+                        link_neighbors(u, std::min(graph.offsets[u] + sample_edges_per_vertex, graph.offsets[u + 1]),
+                                graph.offsets[u + 1]);
+            });
+    if (out_of_range)
+        throw Error<ConnectedComponents>("Neighbor out of range");
+    return label_components(forest, nr_threads);
+}
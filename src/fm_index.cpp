@@ -0,0 +1,197 @@
+#include "fm_index.h"
+
+#include <algorithm>
+
+#include "error.h"
+#include "suffix_array.h"
+
+
+void RankBitVector::build_rank()
+{
+    const std::size_t nr_blocks = words.size() / words_per_block + 1;
+    block_ranks.assign(nr_blocks, 0);
+    std::size_t rank = 0;
+    for (std::size_t w = 0; w < words.size(); ++w) {
+        if (w % words_per_block == 0)
+            block_ranks[w / words_per_block] = rank;
+        rank += std::popcount(words[w]);
+    }
+    if (words.size() % words_per_block == 0)
+        block_ranks[nr_blocks - 1] = rank;
+}
+
+
+FmIndex::FmIndex(std::string_view text, std::size_t sample_rate)
+    : text_size(text.size()), sample_rate(sample_rate)
+{
+    if (sample_rate == 0)
+        throw Error<FmIndex>("The sample rate must be positive");
+
+    // the rows are the text's suffixes in sorted order, preceded by the empty suffix (the sentinel)
+    const std::vector<std::uint64_t> sa = build_suffix_array(text);
+    const std::size_t nr_rows = text_size + 1;
+    auto row_position = [&](std::size_t row) { return row == 0 ? text_size : sa[row - 1]; };
+
+    std::vector<char> bwt;
+    bwt.reserve(text_size);
+    sampled = RankBitVector(nr_rows);
+    for (std::size_t row = 0; row < nr_rows; ++row) {
+        const std::size_t pos = row_position(row);
+        if (pos == 0)
+            sentinel_row = row;
+        else
+            bwt.push_back(text[pos - 1]);
+        if (pos % sample_rate == 0)
+            sampled.set(row);
+    }
+    sampled.build_rank();
+
+    sample_width = std::max<unsigned>(1, std::bit_width(text_size));
+    samples.assign((sampled.rank1(nr_rows) * sample_width + 63) / 64 + 1, 0);
+    for (std::size_t row = 0, i = 0; row < nr_rows; ++row) {
+        if (!sampled[row])
+            continue;
+        const std::uint64_t position = row_position(row);
+        const std::size_t bit = i++ * sample_width;
+        samples[bit / 64] |= position << (bit % 64);
+        if (bit % 64 + sample_width > 64)
+            samples[bit / 64 + 1] |= position >> (64 - bit % 64);
+    }
+
+    const auto sym_freq = count_sym_freq(text.begin(), text.end());
+    first_row.fill(0);
+    for (const auto& [symbol, freq] : sym_freq)
+        first_row[static_cast<unsigned char>(symbol) + 1] = freq;
+    first_row[0] = 1;
+    for (std::size_t c = 1; c < first_row.size(); ++c)
+        first_row[c] += first_row[c - 1];
+
+    if (text_size == 0)
+        return;
+    const auto tree = build_huffman_tree(sym_freq);
+    codebook = build_huffman_codebook(build_huffman_table(tree.get()));
+    root = build_node(tree.get(), 0, std::move(bwt));
+}
+
+std::int32_t FmIndex::build_node(const HuffmanTree<char> *tree, unsigned depth, std::vector<char>&& seq)
+{
+    if (auto symbol = tree->get_symbol())
+        return -1 - static_cast<unsigned char>(*symbol);
+
+    // each symbol goes to the side given by its codeword's bit at this depth
+    std::array<bool, 256> goes_right {};
+    for (const auto& [symbol, codeword] : codebook)
+        if (codeword.length > depth)
+            goes_right[static_cast<unsigned char>(symbol)] = (codeword.bits >> (codeword.length - 1 - depth)) & 1;
+
+    const std::vector<char> input = std::move(seq);
+    std::vector<char> left_seq, right_seq;
+    RankBitVector bits (input.size());
+    for (std::size_t i = 0; i < input.size(); ++i) {
+        if (goes_right[static_cast<unsigned char>(input[i])]) {
+            bits.set(i);
+            right_seq.push_back(input[i]);
+        } else {
+            left_seq.push_back(input[i]);
+        }
+    }
+    bits.build_rank();
+
+    const auto node = static_cast<std::int32_t>(nodes.size());
+    nodes.push_back({std::move(bits), {}});
+    const std::int32_t left_child = build_node(tree->get_left(), depth + 1, std::move(left_seq));
+    const std::int32_t right_child = build_node(tree->get_right(), depth + 1, std::move(right_seq));
+    nodes[node].children = {left_child, right_child};
+    return node;
+}
+
+std::size_t FmIndex::occ(unsigned char c, std::size_t row) const
+{
+    std::size_t i = row - (row > sentinel_row);
+    if (root < 0)
+        return static_cast<unsigned char>(-1 - root) == c ? i : 0;
+
+    const auto it = codebook.find(static_cast<char>(c));
+    if (it == codebook.end())
+        return 0;
+    const HuffmanCodeword codeword = it->second;
+    std::int32_t node = root;
+    for (unsigned d = codeword.length; d-- > 0;) {
+        const bool bit = (codeword.bits >> d) & 1;
+        const std::size_t ones = nodes[node].bits.rank1(i);
+        i = bit ? ones : i - ones;
+        node = nodes[node].children[bit];
+    }
+    return i;
+}
+
+unsigned char FmIndex::symbol_at(std::size_t row) const
+{
+    std::size_t i = row - (row > sentinel_row);
+    std::int32_t node = root;
+    while (node >= 0) {
+        const RankBitVector& bits = nodes[node].bits;
+        const bool bit = bits[i];
+        const std::size_t ones = bits.rank1(i);
+        i = bit ? ones : i - ones;
+        node = nodes[node].children[bit];
+    }
+    return static_cast<unsigned char>(-1 - node);
+}
+
+std::size_t FmIndex::lf(std::size_t row) const
+{
+    const unsigned char c = symbol_at(row);
+    return first_row[c] + occ(c, row);
+}
+
+std::size_t FmIndex::get_sample(std::size_t i) const
+{
+    const std::size_t bit = i * sample_width;
+    std::uint64_t value = samples[bit / 64] >> (bit % 64);
+    if (bit % 64 + sample_width > 64)
+        value |= samples[bit / 64 + 1] << (64 - bit % 64);
+    return value & ((std::uint64_t(1) << sample_width) - 1);
+}
+
+std::pair<std::size_t, std::size_t> FmIndex::find_rows(std::string_view pat) const
+{
+    // the empty pattern matches all the suffixes but the empty one in row 0
+    std::size_t first = pat.empty() ? 1 : 0, last = text_size + 1;
+    for (std::size_t k = pat.size(); k-- > 0 && first < last;) {
+        const auto c = static_cast<unsigned char>(pat[k]);
+        first = first_row[c] + occ(c, first);
+        last = first_row[c] + occ(c, last);
+    }
+    return {first, std::max(first, last)};
+}
+
+std::size_t FmIndex::count(std::string_view pat) const
+{
+    const auto [first, last] = find_rows(pat);
+    return last - first;
+}
+
+std::vector<std::size_t> FmIndex::locate(std::string_view pat) const
+{
+    const auto [first, last] = find_rows(pat);
+    std::vector<std::size_t> positions;
+    positions.reserve(last - first);
+    for (std::size_t row = first; row < last; ++row) {
+        // walk back through the text until a sampled position; the sentinel's row holds position 0, always sampled
+        std::size_t r = row, steps = 0;
+        for (; !sampled[r]; ++steps)
+            r = lf(r);
+        positions.push_back(get_sample(sampled.rank1(r)) + steps);
+    }
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
+
+std::size_t FmIndex::memory_usage() const
+{
+    std::size_t usage = sizeof(*this) + sampled.memory_usage() + samples.capacity() * sizeof(std::uint64_t);
+    for (const Node& node : nodes)
+        usage += sizeof(node) + node.bits.memory_usage();
+    return usage;
+}
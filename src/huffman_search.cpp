@@ -0,0 +1,9 @@
+#include "huffman_search.h"
+
+
+std::size_t huffman_str_find(std::istream& is, const HuffmanDictionary<char>& dictionary, std::string_view pat,
+        std::size_t nr_symbols)
+{
+    HuffmanDecoder<char> decoder {is, dictionary};
+    return huffman_find_pattern(decoder, pat.begin(), pat.size(), nr_symbols).value_or(std::string_view::npos);
+}
@@ -0,0 +1,110 @@
+#include "kmp_pattern_search.h"
+
+#include <atomic>
+#include <thread>
+
+
+/* Minimum number of match start positions per thread; shorter strings are searched with fewer threads. */
+static constexpr std::size_t min_segment_size = 1 << 16;
+/* Number of start positions searched between checks for cancellation when looking for the first match. */
+static constexpr std::size_t cancel_check_interval = 1 << 20;
+
+
+/* Segment of match start positions [begin, end). */
+struct Segment {
+    std::size_t begin, end;
+};
+
+static std::vector<Segment> split_segments(std::size_t str_size, std::size_t pattern_size, unsigned nr_threads)
+{
+    if (pattern_size == 0 || pattern_size > str_size)
+        return {};
+
+    const std::size_t nr_starts = str_size - pattern_size + 1;
+    if (nr_threads == 0)
+        nr_threads = std::max(1u, std::thread::hardware_concurrency());
+    const std::size_t nr_segments = std::clamp<std::size_t>(nr_starts / min_segment_size, 1, nr_threads);
+
+    std::vector<Segment> segments (nr_segments);
+    for (std::size_t i = 0; i < nr_segments; ++i)
+        segments[i] = {nr_starts * i / nr_segments, nr_starts * (i + 1) / nr_segments};
+    return segments;
+}
+
+/* Get the part of the string that contains the matches starting in the segment. */
+static inline std::string_view segment_view(std::string_view str, Segment segment, std::size_t pattern_size)
+{
+    return str.substr(segment.begin, segment.end - segment.begin + pattern_size - 1);
+}
+
+/* Run the function on each segment, the first one on the calling thread and the rest on their own threads. */
+template<typename Function>
+static void run_segments(const std::vector<Segment>& segments, Function&& function)
+{
+    std::vector<std::jthread> threads;
+    threads.reserve(segments.size());
+    for (std::size_t i = 1; i < segments.size(); ++i)
+        threads.emplace_back(function, i);
+    if (!segments.empty())
+        function(0);
+}
+
+
+std::size_t kmp_parallel_find(std::string_view str, const KmpPattern& pattern, unsigned nr_threads)
+{
+    const std::size_t m = pattern.size();
+    if (m == 0)
+        return 0;
+
+    const std::vector<Segment> segments = split_segments(str.size(), m, nr_threads);
+    std::atomic<std::size_t> first_match = std::string_view::npos;
+    run_segments(segments, [&](std::size_t i)
+            {
+                for (std::size_t begin = segments[i].begin; begin < segments[i].end; begin += cancel_check_interval) {
+                    if (first_match.load(std::memory_order_relaxed) < begin)
+                        return;
+                    const Segment block {begin, std::min(begin + cancel_check_interval, segments[i].end)};
+                    const std::size_t match = pattern.find(segment_view(str, block, m));
+                    if (match != std::string_view::npos) {
+                        std::size_t curr = first_match.load(std::memory_order_relaxed);
+                        while (begin + match < curr
+                                && !first_match.compare_exchange_weak(curr, begin + match, std::memory_order_relaxed));
+                        return;
+                    }
+                }
+            });
+    return first_match.load();
+}
+
+std::vector<std::size_t> kmp_parallel_find_all(std::string_view str, const KmpPattern& pattern, unsigned nr_threads)
+{
+    const std::size_t m = pattern.size();
+    const std::vector<Segment> segments = split_segments(str.size(), m, nr_threads);
+    std::vector<std::vector<std::size_t>> segment_matches (segments.size());
+    run_segments(segments, [&](std::size_t i)
+            {
+                for (std::size_t match : pattern.find_all(segment_view(str, segments[i], m)))
+                    segment_matches[i].push_back(segments[i].begin + match);
+            });
+
+    std::vector<std::size_t> matches;
+    for (const auto& part : segment_matches)
+        matches.insert(matches.end(), part.begin(), part.end());
+    return matches;
+}
+
+std::size_t kmp_parallel_count(std::string_view str, const KmpPattern& pattern, unsigned nr_threads)
+{
+    const std::size_t m = pattern.size();
+    const std::vector<Segment> segments = split_segments(str.size(), m, nr_threads);
+    std::vector<std::size_t> segment_counts (segments.size());
+    run_segments(segments, [&](std::size_t i)
+            {
+                segment_counts[i] = pattern.count(segment_view(str, segments[i], m));
+            });
+
+    std::size_t nr_matches = 0;
+    for (std::size_t count : segment_counts)
+        nr_matches += count;
+    return nr_matches;
+}
@@ -1,5 +1,9 @@
 #include "kmp_pattern_search.h"
 
+#include <algorithm>
+
+#include "error.h"
+
 
 std::size_t kmp_str_find_pattern(std::string_view str, std::string_view pat)
 {
@@ -8,6 +12,220 @@ std::size_t kmp_str_find_pattern(std::string_view str, std::string_view pat)
 
 std::size_t kmp_str_find(std::string_view str, std::string_view pat)
 {
-    std::size_t match = kmp_str_find_pattern(str, pat);
-    return pat.size() + match <= str.size() ? match : std::string_view::npos;
+    return KmpPattern(pat).find(str);
+}
+
+template<typename StrView>
+static std::size_t kmp_generic_str_find(StrView str, StrView pat)
+{
+    auto [end_it, match_len] = kmp_find_pattern_raw(str.begin(), str.end(), pat.begin(), pat.size());
+    return match_len == pat.size() ? end_it - str.begin() - match_len : StrView::npos;
+}
+
+std::size_t kmp_str_find(std::u16string_view str, std::u16string_view pat)
+{
+    return kmp_generic_str_find(str, pat);
+}
+
+std::size_t kmp_str_find(std::u32string_view str, std::u32string_view pat)
+{
+    return kmp_generic_str_find(str, pat);
+}
+
+std::size_t horspool_str_find(std::string_view str, std::string_view pat)
+{
+    auto it = horspool_find_pattern(str.begin(), str.end(), pat.begin(), pat.size());
+    return it == str.end() && !pat.empty() ? std::string_view::npos : it - str.begin();
+}
+
+std::size_t two_way_str_find(std::string_view str, std::string_view pat)
+{
+    auto it = two_way_find_pattern(str.begin(), str.end(), pat.begin(), pat.size());
+    return it == str.end() && !pat.empty() ? std::string_view::npos : it - str.begin();
+}
+
+
+
+const char *to_string(StrFindBackend backend)
+{
+    switch (backend) {
+    case StrFindBackend::Simd:
+        return "simd";
+    case StrFindBackend::Horspool:
+        return "horspool";
+    case StrFindBackend::TwoWay:
+        return "two_way";
+    }
+    return "unknown";
+}
+
+/* Longest pattern that is always searched with the vectorized search. */
+static constexpr std::size_t max_short_pattern_size = 8;
+
+StrFindBackend select_str_find_backend(std::string_view pat)
+{
+    std::array<bool, 256> present {};
+    std::size_t nr_distinct = 0;
+    for (unsigned char c : pat)
+        if (!present[c]) {
+            present[c] = true;
+            ++nr_distinct;
+        }
+
+    if (pat.size() <= max_short_pattern_size || pat.size() <= nr_distinct * nr_distinct)
+        return StrFindBackend::Simd;
+    if (nr_distinct >= 4)
+        return StrFindBackend::Horspool;
+    return StrFindBackend::TwoWay;
+}
+
+std::size_t str_find(std::string_view str, std::string_view pat)
+{
+    switch (select_str_find_backend(pat)) {
+    case StrFindBackend::Horspool:
+        return horspool_str_find(str, pat);
+    case StrFindBackend::TwoWay:
+        return two_way_str_find(str, pat);
+    default:
+        return fast_str_find(str, pat);
+    }
+}
+
+
+std::size_t KmpPattern::find(std::string_view str) const
+{
+    if (pattern_size == 0)
+        return 0;
+    return resume(str, 0, 0);
+}
+
+KmpMatchView KmpPattern::find_all(std::string_view str, KmpMatchMode mode) const
+{
+    return KmpMatchView(str, *this, mode);
+}
+
+std::size_t KmpPattern::count(std::string_view str, KmpMatchMode mode) const
+{
+    if (pattern_size == 0)
+        return 0;
+
+    const std::size_t m = pattern_size, restart = restart_state(mode);
+    return visit([str, m, restart](const char *pat, const auto *lps)
+            {
+                std::size_t nr_matches = 0, j = 0;
+                for (std::size_t i = 0; i < str.size(); ++i) {
+                    // nothing is matched, so skip to the next occurrence of the first character with memchr
+                    if (j == 0 && (i = str.find(pat[0], i)) == std::string_view::npos)
+                        break;
+                    const char c = str[i];
+                    while (j > 0 && c != pat[j])
+                        j = lps[j - 1];
+                    if (c == pat[j] && ++j == m) {
+                        ++nr_matches;
+                        j = restart;
+                    }
+                }
+                return nr_matches;
+            });
+}
+
+std::size_t KmpPattern::resume(std::string_view str, std::size_t from, std::size_t j) const
+{
+    return visit([str, from, j, m = pattern_size](const char *pat, const auto *lps) mutable
+            {
+                for (std::size_t i = from; i < str.size(); ++i) {
+                    if (j == 0 && (i = str.find(pat[0], i)) == std::string_view::npos)
+                        break;
+                    const char c = str[i];
+                    while (j > 0 && c != pat[j])
+                        j = lps[j - 1];
+                    if (c == pat[j] && ++j == m)
+                        return i + 1 - m;
+                }
+                return std::string_view::npos;
+            });
+}
+
+std::size_t KmpPattern::restart_state(KmpMatchMode mode) const
+{
+    if (mode == KmpMatchMode::NonOverlapping)
+        return 0;
+    return visit([m = pattern_size](const char *, const auto *lps) -> std::size_t { return lps[m - 1]; });
+}
+
+
+KmpMatchView::KmpMatchView(std::string_view str, std::string_view pat, KmpMatchMode mode)
+    : str(str), pattern(std::make_shared<const KmpPattern>(pat)), mode(mode)
+{}
+
+KmpMatchView::KmpMatchView(std::string_view str, const KmpPattern& pattern, KmpMatchMode mode)
+    : str(str), pattern(std::shared_ptr<const KmpPattern>(), &pattern), mode(mode)
+{}
+
+KmpMatchView kmp_find_all(std::string_view str, std::string_view pat, KmpMatchMode mode)
+{
+    return KmpMatchView(str, pat, mode);
+}
+
+std::size_t kmp_count(std::string_view str, std::string_view pat, KmpMatchMode mode)
+{
+    return KmpPattern(pat).count(str, mode);
+}
+
+
+KmpDfa::KmpDfa(std::string_view pattern)
+    : pattern_size(pattern.size())
+{
+    if ((pattern_size + 1) * alphabet_size > UINT32_MAX)
+        throw Error<KmpDfa>("The pattern is too long to be compiled into a DFA");
+
+    std::vector<std::uint32_t> lps (pattern_size);
+    build_lps(pattern.begin(), lps.begin(), static_cast<std::uint32_t>(pattern_size));
+
+    // a mismatch in state j behaves as in the state of the longest border, which is lps[j - 1]
+    table.resize((pattern_size + 1) * alphabet_size, 0);
+    for (std::size_t j = 0; j <= pattern_size; ++j) {
+        std::uint32_t *const row = table.data() + j * alphabet_size;
+        if (j > 0)
+            std::copy_n(table.data() + lps[j - 1] * alphabet_size, alphabet_size, row);
+        if (j < pattern_size)
+            row[static_cast<unsigned char>(pattern[j])] = static_cast<std::uint32_t>((j + 1) * alphabet_size);
+    }
+}
+
+std::size_t KmpDfa::find(std::string_view str) const
+{
+    if (pattern_size == 0)
+        return 0;
+
+    const std::uint32_t accept = static_cast<std::uint32_t>(pattern_size * alphabet_size);
+    const std::uint32_t *const t = table.data();
+    std::uint32_t offset = 0;
+    for (std::size_t i = 0; i < str.size(); ++i) {
+        offset = t[offset + static_cast<unsigned char>(str[i])];
+        if (offset == accept)
+            return i + 1 - pattern_size;
+    }
+    return std::string_view::npos;
+}
+
+std::size_t KmpDfa::count(std::string_view str) const
+{
+    if (pattern_size == 0)
+        return 0;
+
+    const std::uint32_t accept = static_cast<std::uint32_t>(pattern_size * alphabet_size);
+    const std::uint32_t *const t = table.data();
+    std::uint32_t offset = 0;
+    std::size_t nr_matches = 0;
+    for (unsigned char c : str) {
+        offset = t[offset + c];
+        nr_matches += offset == accept;
+    }
+    return nr_matches;
+}
+
+std::size_t kmp_dfa_str_find(std::string_view str, std::string_view pat)
+{
+    return KmpDfa(pat).find(str);
 }
@@ -0,0 +1,230 @@
+#include "rabin_karp.h"
+
+#include <algorithm>
+#include <bit>
+#include <random>
+
+#include "error.h"
+
+
+/* Hash of the window: the polynomial sum of s[i] * base^(m-1-i) modulo 2^32, which is plain wrapping arithmetic. */
+static std::uint32_t hash_window(const unsigned char *s, std::size_t m, std::uint32_t base)
+{
+    std::uint32_t h = 0;
+    for (std::size_t i = 0; i < m; ++i)
+        h = h * base + s[i];
+    return h;
+}
+
+/* The prime modulus of the fingerprints, with which a reduction takes a shift and an addition. */
+static constexpr std::uint64_t fingerprint_modulus = (std::uint64_t(1) << 61) - 1;
+
+static inline std::uint64_t add_mod61(std::uint64_t a, std::uint64_t b)
+{
+    const std::uint64_t sum = a + b;
+    return sum >= fingerprint_modulus ? sum - fingerprint_modulus : sum;
+}
+
+/* Multiply modulo 2^61 - 1: as 2^61 is 1 modulo it, the high bits of the product fold onto the low ones. */
+static inline std::uint64_t mul_mod61(std::uint64_t a, std::uint64_t b)
+{
+    const unsigned __int128 product = static_cast<unsigned __int128>(a) * b;
+    return add_mod61(static_cast<std::uint64_t>(product) & fingerprint_modulus,
+            static_cast<std::uint64_t>(product >> 61));
+}
+
+/* Fingerprint of the window: the polynomial sum of s[i] * base^(m-1-i) modulo 2^61 - 1. */
+static std::uint64_t fingerprint_window(const unsigned char *s, std::size_t m, std::uint64_t base)
+{
+    std::uint64_t f = 0;
+    for (std::size_t i = 0; i < m; ++i)
+        f = add_mod61(mul_mod61(f, base), s[i]);
+    return f;
+}
+
+/* Spread a hash over the high bits (Fibonacci hashing), which pick the table slot and the filter tag. */
+static inline std::uint32_t mix(std::uint32_t hash)
+{
+    return hash * 0x9E3779B1u;
+}
+
+/* Map a hash to a filter entry by its high bits, with a multiplication instead of a division. */
+static inline std::size_t filter_index(std::uint32_t hash, std::size_t filter_size)
+{
+    return (std::uint64_t(hash) * filter_size) >> 32;
+}
+
+/* Filter entries: empty, a tag (odd) of the hash that falls there, or a mark for several hashes. */
+static constexpr std::uint8_t filter_empty = 0, filter_many = 0xFE;
+
+/* Get the tag of a hash, which is independent of its filter index. */
+static inline std::uint8_t filter_tag(std::uint32_t hash)
+{
+    return static_cast<std::uint8_t>(mix(hash) >> 24) | 1;
+}
+
+
+
+RabinKarp::RabinKarp(const std::vector<std::string_view>& patterns_list)
+    : nr_patterns(patterns_list.size())
+{
+    if (nr_patterns == 0)
+        return;
+    m = patterns_list[0].size();
+    if (m == 0)
+        throw Error<RabinKarp>("Patterns must not be empty");
+    patterns.reserve(nr_patterns * m);
+    for (std::string_view pattern : patterns_list) {
+        if (pattern.size() != m)
+            throw Error<RabinKarp>("Patterns must have the same size");
+        patterns += pattern;
+    }
+
+    // an odd base keeps the wrapping hash from discarding the high bytes of the window, but does not prevent
+    // collisions, which the fingerprints modulo 2^61 - 1 with a random base in [256, 2^61 - 1) rule out
+    std::mt19937_64 rng {std::random_device()()};
+    base = static_cast<std::uint32_t>(rng()) | 1;
+    fingerprint_base = std::uniform_int_distribution<std::uint64_t>(256, fingerprint_modulus - 1)(rng);
+    std::uint32_t top_power = 1;
+    std::uint64_t fingerprint_top_power = 1;
+    for (std::size_t i = 1; i < m; ++i) {
+        top_power *= base;
+        fingerprint_top_power = mul_mod61(fingerprint_top_power, fingerprint_base);
+    }
+    for (unsigned c = 0; c < 256; ++c) {
+        remove_term[c] = -(c * top_power);
+        fingerprint_remove_term[c] = (fingerprint_modulus - mul_mod61(c, fingerprint_top_power)) % fingerprint_modulus;
+    }
+
+    const std::size_t nr_slots = std::bit_ceil(std::max<std::size_t>(2 * nr_patterns, 16));
+    slot_shift = 32 - std::countr_zero(nr_slots);
+    slot_hash.assign(nr_slots, 0);
+    slot_count.assign(nr_slots, 0);
+    slot_first.assign(nr_slots, 0);
+    // with one entry in 16 taken, about one window in 400 that matches no pattern passes the filter,
+    // mostly through the entries shared by several hashes
+    filter.assign(std::bit_ceil(std::max<std::size_t>(16 * nr_patterns, 1 << 12)), filter_empty);
+
+    const auto *const pattern_bytes = reinterpret_cast<const unsigned char *>(patterns.data());
+    std::vector<std::uint32_t> pattern_slot (nr_patterns);
+    for (std::size_t k = 0; k < nr_patterns; ++k) {
+        const std::uint32_t hash = hash_window(pattern_bytes + k * m, m, base);
+        std::uint8_t& entry = filter[filter_index(hash, filter.size())];
+        entry = entry == filter_empty || entry == filter_tag(hash) ? filter_tag(hash) : filter_many;
+        std::size_t slot = mix(hash) >> slot_shift;
+        while (slot_count[slot] && slot_hash[slot] != hash)
+            slot = (slot + 1) & (nr_slots - 1);
+        slot_hash[slot] = hash;
+        ++slot_count[slot];
+        pattern_slot[k] = static_cast<std::uint32_t>(slot);
+    }
+    for (std::size_t slot = 1; slot < nr_slots; ++slot)
+        slot_first[slot] = slot_first[slot - 1] + slot_count[slot - 1];
+    ids.resize(nr_patterns);
+    fingerprints.resize(nr_patterns);
+    std::vector<std::uint32_t> next (slot_first);
+    for (std::size_t k = 0; k < nr_patterns; ++k) {
+        fingerprints[next[pattern_slot[k]]] = fingerprint_window(pattern_bytes + k * m, m, fingerprint_base);
+        ids[next[pattern_slot[k]]++] = static_cast<std::uint32_t>(k);
+    }
+}
+
+std::int64_t RabinKarp::find_slot(std::uint32_t hash) const
+{
+    const std::size_t slot_mask = slot_hash.size() - 1;
+    for (std::size_t slot = mix(hash) >> slot_shift; slot_count[slot]; slot = (slot + 1) & slot_mask)
+        if (slot_hash[slot] == hash)
+            return static_cast<std::int64_t>(slot);
+    return -1;
+}
+
+void RabinKarp::collect_candidates(std::string_view text, std::size_t begin, std::size_t end,
+        std::vector<std::uint32_t>& hashes, std::vector<Candidate>& candidates) const
+{
+    const auto *const s = reinterpret_cast<const unsigned char *>(text.data()) + begin;
+    const std::size_t nr_positions = end - begin;
+    hashes.resize(nr_positions);
+    std::uint32_t *const h = hashes.data();
+
+    // the hashes of the block's windows, rolled in independent lanes: h' = (h - c_out * base^(m-1)) * base + c_in
+    const std::size_t lane_length = nr_positions / nr_lanes, tail = nr_lanes * lane_length;
+    // the members are copied to locals, as the stores to the hashes could otherwise alias them
+    const std::size_t m = this->m;
+    const std::uint32_t base = this->base;
+    const std::uint32_t *const remove_term = this->remove_term;
+    auto roll = [=](std::uint32_t hash, const unsigned char *window)
+    {
+        return (hash + remove_term[window[0]]) * base + window[m];
+    };
+    if (lane_length > 0) {
+        std::uint32_t h0 = hash_window(s, m, base), h1 = hash_window(s + lane_length, m, base);
+        std::uint32_t h2 = hash_window(s + 2 * lane_length, m, base), h3 = hash_window(s + 3 * lane_length, m, base);
+        for (std::size_t i = 0;; ++i) {
+            h[i] = h0;
+            h[i + lane_length] = h1;
+            h[i + 2 * lane_length] = h2;
+            h[i + 3 * lane_length] = h3;
+            if (i + 1 == lane_length)
+                break;
+            h0 = roll(h0, s + i);
+            h1 = roll(h1, s + lane_length + i);
+            h2 = roll(h2, s + 2 * lane_length + i);
+            h3 = roll(h3, s + 3 * lane_length + i);
+        }
+    }
+    if (tail < nr_positions) {
+        h[tail] = hash_window(s + tail, m, base);
+        for (std::size_t i = tail + 1; i < nr_positions; ++i)
+            h[i] = roll(h[i - 1], s + i - 1);
+    }
+
+    // the filter pass, in increasing order of the positions
+    candidates.clear();
+    const std::uint8_t *const filter_data = filter.data();
+    const std::size_t filter_size = filter.size();
+    for (std::size_t i = 0; i < nr_positions; ++i) {
+        const std::uint8_t entry = filter_data[filter_index(h[i], filter_size)];
+        if ((entry == filter_tag(h[i])) | (entry == filter_many)) [[unlikely]] {
+            const std::int64_t slot = find_slot(h[i]);
+            if (slot >= 0)
+                candidates.push_back({begin + i, static_cast<std::uint32_t>(slot), 0});
+        }
+    }
+
+    // the candidates' fingerprints, each rolled from the previous one when that is less than m positions behind,
+    // so that they take O(nr_positions + m) whatever the number of candidates
+    const auto *const t = reinterpret_cast<const unsigned char *>(text.data());
+    std::size_t offset = 0;
+    std::uint64_t fingerprint = 0;
+    for (std::size_t i = 0; i < candidates.size(); ++i) {
+        if (i > 0 && candidates[i].offset - offset < m) {
+            for (; offset < candidates[i].offset; ++offset)
+                fingerprint = add_mod61(mul_mod61(add_mod61(fingerprint, fingerprint_remove_term[t[offset]]),
+                            fingerprint_base), t[offset + m]);
+        } else {
+            offset = candidates[i].offset;
+            fingerprint = fingerprint_window(t + offset, m, fingerprint_base);
+        }
+        candidates[i].fingerprint = fingerprint;
+    }
+}
+
+std::vector<RabinKarp::Match> RabinKarp::find_all(std::string_view text) const
+{
+    std::vector<Match> matches;
+    scan(text, [&matches](std::size_t pattern_id, std::size_t offset)
+            {
+                matches.push_back({pattern_id, offset});
+            });
+    return matches;
+}
+
+std::size_t RabinKarp::count(std::string_view text) const
+{
+    std::size_t nr_matches = 0;
+    scan(text, [&nr_matches](std::size_t, std::size_t)
+            {
+                ++nr_matches;
+            });
+    return nr_matches;
+}
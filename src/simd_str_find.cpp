@@ -0,0 +1,271 @@
+#include "kmp_pattern_search.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SIMD_STR_FIND_X86 1
+#endif
+
+
+/* The first-and-last-byte filter: a position is a candidate only if both the first and the last byte
+ * of the pattern match there, which is checked for a whole vector of positions at once.
+ * Candidates are verified with memcmp. The bytes compared during verification are accounted,
+ * and once they exceed twice the scanned bytes (plus some slack), the rest is searched with KMP,
+ * which keeps the worst case linear for inputs such as "aaaa...ab" in "aaaa...a".
+ * In the case-insensitive mode, the bytes of the text are ORed with 0x20 where the pattern has a letter
+ * before the comparison, which folds letters to lower case (and some other bytes to letters or digits,
+ * which only adds candidates); the candidates are then verified with folding. */
+
+static constexpr std::size_t verify_slack = 4096;
+
+/* Result of a filtered scan: either a match, no match, or the position from which KMP should take over. */
+struct ScanResult {
+    std::size_t pos;
+    bool fallback;
+};
+
+static inline bool over_budget(std::size_t verified, std::size_t scanned)
+{
+    return verified > 2 * scanned + verify_slack;
+}
+
+/* Get the bits to OR a text byte with before comparing it with the pattern byte: 0x20 for letters. */
+static inline char fold_bits(char c)
+{
+    const char lower = c | 0x20;
+    return lower >= 'a' && lower <= 'z' ? 0x20 : 0;
+}
+
+template<bool icase>
+static inline bool verify(const char *s, const char *p, std::size_t m, std::size_t& verified)
+{
+    verified += m;
+    if (m <= 2)
+        return true;
+    if constexpr (icase) {
+        for (std::size_t i = 1; i + 1 < m; ++i)
+            if (ascii_fold(s[i]) != ascii_fold(p[i]))
+                return false;
+        return true;
+    } else {
+        return std::memcmp(s + 1, p + 1, m - 2) == 0;
+    }
+}
+
+/* Scan positions [i, n - m] one by one; shared by the scalar search and the vector loops' tails. */
+template<bool icase>
+static ScanResult scan_scalar(const char *s, std::size_t n, const char *p, std::size_t m,
+        std::size_t i, std::size_t verified)
+{
+    const char first = p[0], last = p[m - 1];
+    if constexpr (icase) {
+        for (; i + m <= n; ++i) {
+            if (ascii_fold(s[i]) == ascii_fold(first) && ascii_fold(s[i + m - 1]) == ascii_fold(last)
+                    && verify<icase>(s + i, p, m, verified))
+                return {i, false};
+            if (over_budget(verified, i))
+                return {i, true};
+        }
+        return {std::string_view::npos, false};
+    }
+
+    while (i + m <= n) {
+        const void *const found = std::memchr(s + i, first, n - m + 1 - i);
+        if (!found)
+            break;
+        i = static_cast<const char *>(found) - s;
+        if (s[i + m - 1] == last && verify<icase>(s + i, p, m, verified))
+            return {i, false};
+        if (over_budget(verified, i))
+            return {i, true};
+        ++i;
+    }
+    return {std::string_view::npos, false};
+}
+
+#ifdef SIMD_STR_FIND_X86
+
+template<bool icase>
+__attribute__((target("sse2")))
+static ScanResult scan_sse2(const char *s, std::size_t n, const char *p, std::size_t m)
+{
+    const char fold_first = icase ? fold_bits(p[0]) : 0, fold_last = icase ? fold_bits(p[m - 1]) : 0;
+    const __m128i first = _mm_set1_epi8(p[0] | fold_first), last = _mm_set1_epi8(p[m - 1] | fold_last);
+    const __m128i or_first = _mm_set1_epi8(fold_first), or_last = _mm_set1_epi8(fold_last);
+    std::size_t i = 0, verified = 0;
+    for (; i + m - 1 + 16 <= n; i += 16) {
+        __m128i block_first = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i));
+        __m128i block_last = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + i + m - 1));
+        if constexpr (icase) {
+            block_first = _mm_or_si128(block_first, or_first);
+            block_last = _mm_or_si128(block_last, or_last);
+        }
+        unsigned mask = _mm_movemask_epi8(
+                _mm_and_si128(_mm_cmpeq_epi8(first, block_first), _mm_cmpeq_epi8(last, block_last)));
+        for (; mask; mask &= mask - 1) {
+            const std::size_t pos = i + __builtin_ctz(mask);
+            if (verify<icase>(s + pos, p, m, verified))
+                return {pos, false};
+        }
+        if (over_budget(verified, i))
+            return {i, true};
+    }
+    return scan_scalar<icase>(s, n, p, m, i, verified);
+}
+
+template<bool icase>
+__attribute__((target("avx2")))
+static ScanResult scan_avx2(const char *s, std::size_t n, const char *p, std::size_t m)
+{
+    const char fold_first = icase ? fold_bits(p[0]) : 0, fold_last = icase ? fold_bits(p[m - 1]) : 0;
+    const __m256i first = _mm256_set1_epi8(p[0] | fold_first), last = _mm256_set1_epi8(p[m - 1] | fold_last);
+    const __m256i or_first = _mm256_set1_epi8(fold_first), or_last = _mm256_set1_epi8(fold_last);
+    std::size_t i = 0, verified = 0;
+    for (; i + m - 1 + 32 <= n; i += 32) {
+        __m256i block_first = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i));
+        __m256i block_last = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(s + i + m - 1));
+        if constexpr (icase) {
+            block_first = _mm256_or_si256(block_first, or_first);
+            block_last = _mm256_or_si256(block_last, or_last);
+        }
+        unsigned mask = _mm256_movemask_epi8(
+                _mm256_and_si256(_mm256_cmpeq_epi8(first, block_first), _mm256_cmpeq_epi8(last, block_last)));
+        for (; mask; mask &= mask - 1) {
+            const std::size_t pos = i + __builtin_ctz(mask);
+            if (verify<icase>(s + pos, p, m, verified))
+                return {pos, false};
+        }
+        if (over_budget(verified, i))
+            return {i, true};
+    }
+    return scan_scalar<icase>(s, n, p, m, i, verified);
+}
+
+template<bool icase>
+__attribute__((target("avx512f,avx512bw")))
+static ScanResult scan_avx512(const char *s, std::size_t n, const char *p, std::size_t m)
+{
+    const char fold_first = icase ? fold_bits(p[0]) : 0, fold_last = icase ? fold_bits(p[m - 1]) : 0;
+    const __m512i first = _mm512_set1_epi8(p[0] | fold_first), last = _mm512_set1_epi8(p[m - 1] | fold_last);
+    const __m512i or_first = _mm512_set1_epi8(fold_first), or_last = _mm512_set1_epi8(fold_last);
+    std::size_t i = 0, verified = 0;
+    for (; i + m - 1 + 64 <= n; i += 64) {
+        __m512i block_first = _mm512_loadu_si512(s + i);
+        __m512i block_last = _mm512_loadu_si512(s + i + m - 1);
+        if constexpr (icase) {
+            block_first = _mm512_or_si512(block_first, or_first);
+            block_last = _mm512_or_si512(block_last, or_last);
+        }
+        std::uint64_t mask = _mm512_cmpeq_epi8_mask(first, block_first) & _mm512_cmpeq_epi8_mask(last, block_last);
+        for (; mask; mask &= mask - 1) {
+            const std::size_t pos = i + __builtin_ctzll(mask);
+            if (verify<icase>(s + pos, p, m, verified))
+                return {pos, false};
+        }
+        if (over_budget(verified, i))
+            return {i, true};
+    }
+    return scan_scalar<icase>(s, n, p, m, i, verified);
+}
+
+#endif
+
+
+SimdLevel detect_simd_level()
+{
+#ifdef SIMD_STR_FIND_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw"))
+        return SimdLevel::AVX512;
+    if (__builtin_cpu_supports("avx2"))
+        return SimdLevel::AVX2;
+    if (__builtin_cpu_supports("sse2"))
+        return SimdLevel::SSE2;
+#endif
+    return SimdLevel::Scalar;
+}
+
+template<bool icase>
+static std::size_t dispatch_str_find(std::string_view str, std::string_view pat, SimdLevel level)
+{
+    const std::size_t n = str.size(), m = pat.size();
+    if (m == 0)
+        return 0;
+    if (m > n)
+        return std::string_view::npos;
+    if (!icase && m == 1) {
+        const void *const found = std::memchr(str.data(), pat[0], n);
+        return found ? static_cast<const char *>(found) - str.data() : std::string_view::npos;
+    }
+
+    ScanResult result;
+    switch (level) {
+#ifdef SIMD_STR_FIND_X86
+    case SimdLevel::AVX512:
+        result = scan_avx512<icase>(str.data(), n, pat.data(), m);
+        break;
+    case SimdLevel::AVX2:
+        result = scan_avx2<icase>(str.data(), n, pat.data(), m);
+        break;
+    case SimdLevel::SSE2:
+        result = scan_sse2<icase>(str.data(), n, pat.data(), m);
+        break;
+#endif
+    default:
+        result = scan_scalar<icase>(str.data(), n, pat.data(), m, 0, 0);
+        break;
+    }
+    if (!result.fallback)
+        return result.pos;
+
+    const std::string_view rest = str.substr(result.pos);
+    std::size_t match;
+    if constexpr (icase) {
+        auto [end_it, match_len] = kmp_find_pattern_raw(rest.begin(), rest.end(), pat.begin(), m, AsciiFoldEqual());
+        match = match_len == m ? end_it - rest.begin() - m : std::string_view::npos;
+    } else {
+        match = kmp_str_find(rest, pat);
+    }
+    return match == std::string_view::npos ? match : result.pos + match;
+}
+
+std::size_t fast_str_find(std::string_view str, std::string_view pat, SimdLevel level)
+{
+    return dispatch_str_find<false>(str, pat, level);
+}
+
+std::size_t fast_str_find(std::string_view str, std::string_view pat)
+{
+    static const SimdLevel level = detect_simd_level();
+    return fast_str_find(str, pat, level);
+}
+
+std::size_t fast_str_find_icase(std::string_view str, std::string_view pat, SimdLevel level)
+{
+    return dispatch_str_find<true>(str, pat, level);
+}
+
+std::size_t fast_str_find_icase(std::string_view str, std::string_view pat)
+{
+    static const SimdLevel level = detect_simd_level();
+    return fast_str_find_icase(str, pat, level);
+}
+
+std::size_t utf8_str_find(std::string_view str, std::string_view pat)
+{
+    auto is_boundary = [str](std::size_t pos)
+    {
+        return pos == str.size() || (static_cast<unsigned char>(str[pos]) & 0xC0) != 0x80;
+    };
+
+    for (std::size_t pos = 0; pos + pat.size() <= str.size(); ++pos) {
+        const std::size_t match = fast_str_find(str.substr(pos), pat);
+        if (match == std::string_view::npos)
+            break;
+        pos += match;
+        if (is_boundary(pos) && is_boundary(pos + pat.size()))
+            return pos;
+    }
+    return std::string_view::npos;
+}
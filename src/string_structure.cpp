@@ -0,0 +1,369 @@
+#include "string_structure.h"
+
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string>
+
+
+std::vector<std::uint32_t> build_z_array(std::string_view str)
+{
+    std::vector<std::uint32_t> z (str.size());
+    build_z_array(str.begin(), z.begin(), static_cast<std::uint32_t>(str.size()));
+    return z;
+}
+
+std::vector<std::uint32_t> build_lps(std::string_view str)
+{
+    std::vector<std::uint32_t> lps (str.size());
+    build_lps(str.begin(), lps.begin(), static_cast<std::uint32_t>(str.size()));
+    return lps;
+}
+
+/* The largest table of the prefix-function automaton: past the caches, the row copies cost more than
+ * the branches they save, and build_lps is used instead. */
+static constexpr std::size_t max_automaton_bytes = 4 << 20;
+
+/* Dense codes of the bytes of a string with a small alphabet. */
+struct SmallAlphabet {
+    std::array<std::uint8_t, 256> code;
+    std::size_t size;
+};
+
+/* Assign dense codes to the bytes of the string in the order of their appearance;
+ * false if there are more than max_small_alphabet distinct bytes. */
+static bool find_small_alphabet(std::string_view str, SmallAlphabet& alphabet)
+{
+    std::array<bool, 256> seen {};
+    for (char c : str)
+        seen[static_cast<unsigned char>(c)] = true;
+    alphabet.size = 0;
+    for (std::size_t c = 0; c < 256; ++c) {
+        if (!seen[c])
+            continue;
+        if (alphabet.size == max_small_alphabet)
+            return false;
+        alphabet.code[c] = static_cast<std::uint8_t>(alphabet.size++);
+    }
+    return true;
+}
+
+/* The prefix-function automaton over rows of W transitions (W >= the alphabet size); only the rows
+ * of the states 0..size-1 are needed, and rows holds at least size * W elements. */
+template<std::size_t W>
+static void lps_automaton(std::string_view str, const SmallAlphabet& alphabet, std::uint32_t *lps,
+        std::uint32_t *rows)
+{
+    auto code = [&](std::size_t i)
+    {
+        return alphabet.code[static_cast<unsigned char>(str[i])];
+    };
+    std::fill(rows, rows + W, 0);
+    rows[code(0)] = 1;
+    lps[0] = 0;
+    std::uint32_t border = 0;
+    for (std::size_t i = 1; i < str.size(); ++i) {
+        const std::uint32_t *const border_row = rows + border * W;
+        std::uint32_t *const row = rows + i * W;
+        const std::uint8_t c = code(i);
+        std::memcpy(row, border_row, W * sizeof(std::uint32_t));
+        row[c] = static_cast<std::uint32_t>(i + 1);
+        lps[i] = border = border_row[c];
+    }
+}
+
+/* Get the row width of the automaton for the alphabet. */
+static std::size_t automaton_width(const SmallAlphabet& alphabet)
+{
+    return alphabet.size <= 2 ? 2 : alphabet.size <= 4 ? 4 : alphabet.size <= 8 ? 8 : 16;
+}
+
+static void lps_automaton(std::string_view str, const SmallAlphabet& alphabet, std::uint32_t *lps,
+        std::uint32_t *rows)
+{
+    if (str.empty())
+        return;
+    switch (automaton_width(alphabet)) {
+    case 2:
+        return lps_automaton<2>(str, alphabet, lps, rows);
+    case 4:
+        return lps_automaton<4>(str, alphabet, lps, rows);
+    case 8:
+        return lps_automaton<8>(str, alphabet, lps, rows);
+    default:
+        return lps_automaton<16>(str, alphabet, lps, rows);
+    }
+}
+
+std::vector<std::uint32_t> build_lps_small_alphabet(std::string_view str)
+{
+    SmallAlphabet alphabet;
+    if (!find_small_alphabet(str, alphabet)
+            || str.size() * automaton_width(alphabet) * sizeof(std::uint32_t) > max_automaton_bytes)
+        return build_lps(str);
+    std::vector<std::uint32_t> lps (str.size()), rows (str.size() * automaton_width(alphabet));
+    lps_automaton(str, alphabet, lps.data(), rows.data());
+    return lps;
+}
+
+
+std::size_t shortest_period(std::string_view str)
+{
+    if (str.empty())
+        return 0;
+    return str.size() - build_lps(str).back();
+}
+
+std::vector<std::size_t> all_periods(std::string_view str)
+{
+    std::vector<std::size_t> periods;
+    if (str.empty())
+        return periods;
+    const std::vector<std::uint32_t> lps = build_lps(str);
+    for (std::uint32_t border = lps.back(); border > 0; border = lps[border - 1])
+        periods.push_back(str.size() - border);
+    periods.push_back(str.size());
+    return periods;
+}
+
+
+BorderTree::BorderTree(std::string_view str)
+    : parent_(str.size() + 1), depth_(str.size() + 1), jump(str.size() + 1),
+      entry_time(str.size() + 1), exit_time(str.size() + 1)
+{
+    const std::size_t n = str.size();
+    const std::vector<std::uint32_t> lps = build_lps(str);
+    for (std::size_t i = 1; i <= n; ++i) {
+        // a parent is always a smaller node, so the nodes are visited after their parents
+        const std::uint32_t p = parent_[i] = lps[i - 1];
+        depth_[i] = depth_[p] + 1;
+        const std::uint32_t jp = jump[p];
+        jump[i] = depth_[p] - depth_[jp] == depth_[jp] - depth_[jump[jp]] ? jump[jp] : p;
+    }
+
+    // subtree sizes, accumulated from the children in decreasing order, then preorder times assigned top down
+    std::vector<std::uint32_t>& subtree_size = exit_time;
+    std::fill(subtree_size.begin(), subtree_size.end(), 1);
+    for (std::size_t i = n; i > 0; --i)
+        subtree_size[parent_[i]] += subtree_size[i];
+    std::vector<std::uint32_t> next_child_time (n + 1);
+    next_child_time[0] = 1;
+    for (std::size_t i = 1; i <= n; ++i) {
+        entry_time[i] = next_child_time[parent_[i]];
+        next_child_time[parent_[i]] += subtree_size[i];
+        next_child_time[i] = entry_time[i] + 1;
+    }
+    for (std::size_t i = 0; i <= n; ++i)
+        exit_time[i] += entry_time[i];
+}
+
+std::size_t BorderTree::ancestor(std::size_t i, std::uint32_t depth) const
+{
+    while (depth_[i] > depth)
+        i = depth_[jump[i]] >= depth ? jump[i] : parent_[i];
+    return i;
+}
+
+std::size_t BorderTree::longest_common_border(std::size_t i, std::size_t j) const
+{
+    if (depth_[i] > depth_[j])
+        i = ancestor(i, depth_[j]);
+    else
+        j = ancestor(j, depth_[i]);
+    // the nodes are at equal depths, so their jump pointers are at equal depths too
+    while (i != j) {
+        if (jump[i] != jump[j]) {
+            i = jump[i];
+            j = jump[j];
+        } else {
+            i = parent_[i];
+            j = parent_[j];
+        }
+    }
+    return i;
+}
+
+
+/* Range minimum queries in O(1) after linear preprocessing: a sparse table over the minima of 64-element blocks,
+ * and for each position a mask of the in-block positions on the min-stack after it, whose lowest bit
+ * at or after the query's start marks the minimum of an in-block range. */
+class RangeMin {
+public:
+    explicit RangeMin(std::span<const std::uint64_t> values) : values(values), masks(values.size())
+    {
+        const std::size_t n = values.size(), nr_blocks = (n + 63) / 64;
+        std::vector<std::uint64_t> block_min (nr_blocks);
+        for (std::size_t b = 0; b < nr_blocks; ++b) {
+            std::uint64_t mask = 0;
+            const std::size_t start = b * 64, end = std::min(n, start + 64);
+            for (std::size_t i = start; i < end; ++i) {
+                while (mask && values[start + 63 - std::countl_zero(mask)] >= values[i])
+                    mask ^= std::uint64_t(1) << (63 - std::countl_zero(mask));
+                masks[i] = mask |= std::uint64_t(1) << (i - start);
+            }
+            block_min[b] = values[start + std::countr_zero(mask)];
+        }
+        table.push_back(std::move(block_min));
+        for (std::size_t width = 2; width <= nr_blocks; width *= 2) {
+            const std::vector<std::uint64_t>& prev = table.back();
+            std::vector<std::uint64_t> level (nr_blocks - width + 1);
+            for (std::size_t b = 0; b < level.size(); ++b)
+                level[b] = std::min(prev[b], prev[b + width / 2]);
+            table.push_back(std::move(level));
+        }
+    }
+
+    /* Get the minimum of the values in [l, r]. */
+    std::uint64_t min(std::size_t l, std::size_t r) const
+    {
+        const std::size_t bl = l / 64, br = r / 64;
+        if (bl == br)
+            return in_block(l, r);
+        std::uint64_t result = std::min(in_block(l, bl * 64 + 63), in_block(br * 64, r));
+        if (bl + 1 < br) {
+            const unsigned k = std::bit_width(br - bl - 1) - 1;
+            result = std::min({result, table[k][bl + 1], table[k][br - (std::size_t(1) << k)]});
+        }
+        return result;
+    }
+
+private:
+    inline std::uint64_t in_block(std::size_t l, std::size_t r) const
+    {
+        return values[l + std::countr_zero(masks[r] >> (l % 64))];
+    }
+
+    std::span<const std::uint64_t> values;
+    std::vector<std::uint64_t> masks;
+    std::vector<std::vector<std::uint64_t>> table;
+};
+
+/* Longest common extension queries on a string: the length of the common prefix of two suffixes,
+ * the minimum of the LCP array between their ranks. */
+class LongestCommonExtension {
+public:
+    explicit LongestCommonExtension(std::string_view str)
+        : sa(build_suffix_array(str)), lcp(build_lcp_array(str, sa, 1)), rank(str.size()), lcp_min(lcp)
+    {
+        for (std::size_t i = 0; i < sa.size(); ++i)
+            rank[sa[i]] = static_cast<std::uint32_t>(i);
+    }
+
+    std::size_t operator()(std::size_t i, std::size_t j) const
+    {
+        const std::size_t n = rank.size();
+        if (i == n || j == n)
+            return 0;
+        if (i == j)
+            return n - i;
+        const auto [a, b] = std::minmax(rank[i], rank[j]);
+        return lcp_min.min(a + 1, b);
+    }
+
+    std::vector<std::uint64_t> sa, lcp;
+    std::vector<std::uint32_t> rank;
+    RangeMin lcp_min;
+};
+
+/* Get the ends of the longest Lyndon words starting at each position: the next position with a smaller suffix. */
+static std::vector<std::uint32_t> lyndon_ends(std::span<const std::uint32_t> rank)
+{
+    const std::size_t n = rank.size();
+    std::vector<std::uint32_t> ends (n), stack;
+    for (std::size_t i = n; i-- > 0;) {
+        while (!stack.empty() && rank[stack.back()] > rank[i])
+            stack.pop_back();
+        ends[i] = stack.empty() ? static_cast<std::uint32_t>(n) : stack.back();
+        stack.push_back(static_cast<std::uint32_t>(i));
+    }
+    return ends;
+}
+
+std::vector<StringRun> find_runs(std::string_view str)
+{
+    const std::size_t n = str.size();
+    std::vector<StringRun> runs;
+    if (n < 2)
+        return runs;
+
+    const LongestCommonExtension forward {str};
+    const std::string reversed (str.rbegin(), str.rend());
+    const LongestCommonExtension backward {reversed};
+
+    // the reversed alphabet order is the lexicographic order of the complemented string
+    std::string complemented (str);
+    for (char& c : complemented)
+        c = static_cast<char>(~c);
+    const std::vector<std::uint64_t> complemented_sa = build_suffix_array(complemented);
+    std::vector<std::uint32_t> complemented_rank (n);
+    for (std::size_t i = 0; i < n; ++i)
+        complemented_rank[complemented_sa[i]] = static_cast<std::uint32_t>(i);
+
+    const std::vector<std::uint32_t> *const ranks[] = {&forward.rank, &complemented_rank};
+    for (const std::vector<std::uint32_t> *rank : ranks) {
+        const std::vector<std::uint32_t> ends = lyndon_ends(*rank);
+        for (std::size_t i = 0; i < n; ++i) {
+            const std::size_t j = ends[i], period = j - i;
+            const std::size_t right = forward(i, j), left = backward(n - i, n - j);
+            if (left + right >= period)
+                runs.push_back({i - left, j + right, period});
+        }
+    }
+
+    std::sort(runs.begin(), runs.end(), [](const StringRun& a, const StringRun& b)
+            {
+                return a.start != b.start ? a.start < b.start : a.end < b.end;
+            });
+    runs.erase(std::unique(runs.begin(), runs.end()), runs.end());
+    return runs;
+}
+
+
+/* Get the size of the longest string of the batch. */
+static std::size_t max_string_size(const StringBatch& batch)
+{
+    std::size_t max_size = 0;
+    for (std::size_t k = 0; k < batch.size(); ++k)
+        max_size = std::max(max_size, batch[k].size());
+    return max_size;
+}
+
+void batch_build_lps(const StringBatch& batch, std::span<std::uint32_t> lps)
+{
+    // the alphabet is found once for the whole batch, and one automaton table is reused by all strings
+    SmallAlphabet alphabet;
+    const std::size_t max_size = max_string_size(batch);
+    if (find_small_alphabet(batch.data, alphabet)
+            && max_size * automaton_width(alphabet) * sizeof(std::uint32_t) <= max_automaton_bytes) {
+        std::vector<std::uint32_t> rows (max_size * automaton_width(alphabet));
+        for (std::size_t k = 0; k < batch.size(); ++k)
+            lps_automaton(batch[k], alphabet, lps.data() + batch.offsets[k], rows.data());
+        return;
+    }
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const std::string_view str = batch[k];
+        build_lps(str.begin(), lps.begin() + batch.offsets[k], static_cast<std::uint32_t>(str.size()));
+    }
+}
+
+void batch_build_z_array(const StringBatch& batch, std::span<std::uint32_t> z)
+{
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const std::string_view str = batch[k];
+        build_z_array(str.begin(), z.begin() + batch.offsets[k], static_cast<std::uint32_t>(str.size()));
+    }
+}
+
+void batch_shortest_periods(const StringBatch& batch, std::span<std::uint32_t> periods)
+{
+    std::vector<std::uint32_t> lps (max_string_size(batch));
+    for (std::size_t k = 0; k < batch.size(); ++k) {
+        const std::string_view str = batch[k];
+        const auto size = static_cast<std::uint32_t>(str.size());
+        build_lps(str.begin(), lps.begin(), size);
+        periods[k] = size == 0 ? 0 : size - lps[size - 1];
+    }
+}
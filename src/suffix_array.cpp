@@ -0,0 +1,391 @@
+#include "suffix_array.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+#ifdef SUFFIX_ARRAY_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "error.h"
+
+
+/* SA-IS over an integer string with characters in [0, upper].
+ * Suffixes are classified as S-type (smaller than the next suffix) or L-type; the leftmost S-type ones (LMS)
+ * are sorted by inducing from their first characters, named, and sorted recursively if the names are not unique,
+ * after which one more induction sorts all the suffixes. */
+template<typename Index, typename Chr>
+static std::vector<Index> sa_is(const Chr *s, Index n, Index upper)
+{
+    if (n == 0)
+        return {};
+    if (n == 1)
+        return {0};
+    if (n == 2)
+        return s[0] < s[1] ? std::vector<Index> {0, 1} : std::vector<Index> {1, 0};
+
+    std::vector<Index> sa (n);
+    std::vector<bool> is_s (n);
+    for (Index i = n - 2; i >= 0; --i)
+        is_s[i] = s[i] == s[i + 1] ? is_s[i + 1] : s[i] < s[i + 1];
+
+    // bucket starts of the S-type and the L-type suffixes of each character
+    std::vector<Index> sum_l (upper + 1), sum_s (upper + 1);
+    for (Index i = 0; i < n; ++i) {
+        if (!is_s[i])
+            ++sum_s[s[i]];
+        else
+            ++sum_l[s[i] + 1];
+    }
+    for (Index c = 0; c <= upper; ++c) {
+        sum_s[c] += sum_l[c];
+        if (c < upper)
+            sum_l[c + 1] += sum_s[c];
+    }
+
+    auto induce = [&](const std::vector<Index>& lms)
+    {
+        std::fill(sa.begin(), sa.end(), -1);
+        std::vector<Index> buf (sum_s);
+        for (Index d : lms)
+            if (d != n)
+                sa[buf[s[d]]++] = d;
+        buf = sum_l;
+        sa[buf[s[n - 1]]++] = n - 1;
+        for (Index i = 0; i < n; ++i) {
+            const Index v = sa[i];
+            if (v >= 1 && !is_s[v - 1])
+                sa[buf[s[v - 1]]++] = v - 1;
+        }
+        buf = sum_l;
+        for (Index i = n - 1; i >= 0; --i) {
+            const Index v = sa[i];
+            if (v >= 1 && is_s[v - 1])
+                sa[--buf[s[v - 1] + 1]] = v - 1;
+        }
+    };
+
+    std::vector<Index> lms_map (n + 1, -1), lms;
+    for (Index i = 1; i < n; ++i)
+        if (!is_s[i - 1] && is_s[i]) {
+            lms_map[i] = static_cast<Index>(lms.size());
+            lms.push_back(i);
+        }
+    const Index m = static_cast<Index>(lms.size());
+    induce(lms);
+    if (m == 0)
+        return sa;
+
+    std::vector<Index> sorted_lms;
+    sorted_lms.reserve(m);
+    for (Index v : sa)
+        if (lms_map[v] != -1)
+            sorted_lms.push_back(v);
+
+    // name the LMS substrings by their order, equal ones getting equal names
+    std::vector<Index> rec_s (m);
+    Index rec_upper = 0;
+    rec_s[lms_map[sorted_lms[0]]] = 0;
+    for (Index i = 1; i < m; ++i) {
+        Index l = sorted_lms[i - 1], r = sorted_lms[i];
+        const Index end_l = lms_map[l] + 1 < m ? lms[lms_map[l] + 1] : n;
+        const Index end_r = lms_map[r] + 1 < m ? lms[lms_map[r] + 1] : n;
+        bool same = end_l - l == end_r - r;
+        if (same) {
+            while (l < end_l && s[l] == s[r]) {
+                ++l;
+                ++r;
+            }
+            same = l != n && s[l] == s[r];
+        }
+        if (!same)
+            ++rec_upper;
+        rec_s[lms_map[sorted_lms[i]]] = rec_upper;
+    }
+
+    const std::vector<Index> rec_sa = sa_is(rec_s.data(), m, rec_upper);
+    for (Index i = 0; i < m; ++i)
+        sorted_lms[i] = lms[rec_sa[i]];
+    induce(sorted_lms);
+    return sa;
+}
+
+std::vector<std::uint64_t> build_suffix_array(std::string_view text)
+{
+    const auto *const s = reinterpret_cast<const unsigned char *>(text.data());
+    auto convert = [](const auto& sa) { return std::vector<std::uint64_t>(sa.begin(), sa.end()); };
+    if (text.size() < (std::size_t(1) << 31) - 1)
+        return convert(sa_is<std::int32_t>(s, static_cast<std::int32_t>(text.size()), 255));
+    return convert(sa_is<std::int64_t>(s, static_cast<std::int64_t>(text.size()), 255));
+}
+
+std::vector<std::uint64_t> build_lcp_array(std::string_view text, std::span<const std::uint64_t> sa,
+        unsigned nr_threads)
+{
+    const std::size_t n = text.size();
+    std::vector<std::uint64_t> rank (n), lcp (n, 0);
+    for (std::size_t i = 0; i < n; ++i)
+        rank[sa[i]] = i;
+
+    if (nr_threads == 0)
+        nr_threads = std::max(1u, std::thread::hardware_concurrency());
+    nr_threads = static_cast<unsigned>(std::clamp<std::size_t>(n >> 16, 1, nr_threads));
+
+    // Kasai's algorithm over the text positions [begin, end); the running length h is only a lower bound,
+    // so each part can start it from zero
+    auto kasai = [&](std::size_t begin, std::size_t end)
+    {
+        std::size_t h = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (rank[i] == 0) {
+                h = 0;
+                continue;
+            }
+            const std::size_t j = sa[rank[i] - 1];
+            while (i + h < n && j + h < n && text[i + h] == text[j + h])
+                ++h;
+            lcp[rank[i]] = h;
+            if (h > 0)
+                --h;
+        }
+    };
+
+    std::vector<std::jthread> threads;
+    for (unsigned t = 1; t < nr_threads; ++t)
+        threads.emplace_back(kasai, n * t / nr_threads, n * (t + 1) / nr_threads);
+    kasai(0, n / nr_threads);
+    return lcp;
+}
+
+
+/* Precompute the LCPs of the search steps of find_range from the LCP array. The steps are numbered by
+ * the positions p = i + 1 of the suffixes, with the virtual bounds 0 and n + 1 sharing nothing with any suffix:
+ * the step between the bounds lo and hi looks at the middle mid = (lo + hi) / 2, so every suffix is the middle
+ * of exactly one step, which stores its LCPs with lo and hi. Return the LCP of the bounds lo and hi. */
+static std::uint64_t build_search_lcps(std::span<const std::uint64_t> lcp, std::size_t lo, std::size_t hi,
+        std::vector<std::uint64_t>& lcp_left, std::vector<std::uint64_t>& lcp_right)
+{
+    const bool is_virtual = lo == 0 || hi == lcp.size() + 1;
+    if (hi - lo == 1)
+        return is_virtual ? 0 : lcp[hi - 1];
+    const std::size_t mid = lo + (hi - lo) / 2;
+    lcp_left[mid - 1] = build_search_lcps(lcp, lo, mid, lcp_left, lcp_right);
+    lcp_right[mid - 1] = build_search_lcps(lcp, mid, hi, lcp_left, lcp_right);
+    return is_virtual ? 0 : std::min(lcp_left[mid - 1], lcp_right[mid - 1]);
+}
+
+
+/* Data of a built index. */
+struct SuffixArray::Storage {
+    std::string text;
+    std::vector<std::uint64_t> sa, lcp_left, lcp_right;
+};
+
+#ifdef SUFFIX_ARRAY_MMAP
+/* Read-only memory mapping of a whole file. */
+class SuffixArray::Mapping {
+public:
+    explicit Mapping(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw Error<SuffixArray>("Failed to open the index file " + path, errno);
+        struct stat st;
+        if (fstat(fd, &st) < 0 || st.st_size == 0) {
+            close(fd);
+            throw Error<SuffixArray>("Failed to map the index file " + path);
+        }
+        void *const addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (addr == MAP_FAILED)
+            throw Error<SuffixArray>("Failed to map the index file " + path, errno);
+        data = static_cast<const char *>(addr);
+        size = st.st_size;
+    }
+
+    ~Mapping()
+    {
+        munmap(const_cast<char *>(data), size);
+    }
+
+    const char *data;
+    std::size_t size;
+};
+#else
+/* Whole file read into memory, where memory mapping is not supported; the buffer is aligned for the arrays. */
+class SuffixArray::Mapping {
+public:
+    explicit Mapping(const std::string& path)
+    {
+        std::ifstream ifs {path, std::ios_base::binary | std::ios_base::ate};
+        if (!ifs)
+            throw Error<SuffixArray>("Failed to open the index file " + path);
+        size = static_cast<std::size_t>(ifs.tellg());
+        buffer.resize((size + 7) / 8);
+        ifs.seekg(0);
+        if (!ifs.read(reinterpret_cast<char *>(buffer.data()), size))
+            throw Error<SuffixArray>("Failed to read the index file " + path);
+        data = reinterpret_cast<const char *>(buffer.data());
+    }
+
+    const char *data;
+    std::size_t size;
+
+private:
+    std::vector<std::uint64_t> buffer;
+};
+#endif
+
+
+/* Index file layout: the magic, the text size, the text padded to 8 bytes, the suffix array and the LCPs
+ * of the search steps with their lower and upper bounds, all in little-endian byte order, which must be
+ * the native one, as the arrays are used in place. */
+static constexpr char index_magic[8] = {'S', 'U', 'F', 'A', 'I', 'D', 'X', '2'};
+
+static inline std::size_t padded_size(std::size_t size)
+{
+    return (size + 7) & ~std::size_t(7);
+}
+
+
+SuffixArray::SuffixArray(std::string text, unsigned nr_threads)
+{
+    auto built = std::make_shared<Storage>();
+    built->text = std::move(text);
+    built->sa = build_suffix_array(built->text);
+    const std::size_t n = built->sa.size();
+    built->lcp_left.resize(n);
+    built->lcp_right.resize(n);
+    build_search_lcps(build_lcp_array(built->text, built->sa, nr_threads), 0, n + 1,
+            built->lcp_left, built->lcp_right);
+    text_view = built->text;
+    sa = built->sa;
+    lcp_left = built->lcp_left;
+    lcp_right = built->lcp_right;
+    storage = std::move(built);
+}
+
+SuffixArray SuffixArray::load(const std::string& path)
+{
+    static_assert(std::endian::native == std::endian::little, "The index file is little-endian");
+
+    SuffixArray index;
+    auto mapping = std::make_shared<const Mapping>(path);
+    const char *const data = mapping->data;
+    std::uint64_t n;
+    if (mapping->size < sizeof(index_magic) + sizeof(n) || std::memcmp(data, index_magic, sizeof(index_magic)))
+        throw Error<SuffixArray>("Invalid index file " + path);
+    std::memcpy(&n, data + sizeof(index_magic), sizeof(n));
+    // the text takes at least one byte and the arrays 24 bytes per position, which bounds n before any offset
+    // is computed from it, as a forged n could otherwise wrap the offsets around to the size of the file
+    if (n > (mapping->size - sizeof(index_magic) - sizeof(n)) / (1 + 3 * sizeof(std::uint64_t)))
+        throw Error<SuffixArray>("Truncated index file " + path);
+
+    const std::size_t text_offset = sizeof(index_magic) + sizeof(n);
+    const std::size_t sa_offset = text_offset + padded_size(n);
+    const std::size_t lcp_left_offset = sa_offset + n * sizeof(std::uint64_t);
+    const std::size_t lcp_right_offset = lcp_left_offset + n * sizeof(std::uint64_t);
+    if (mapping->size != lcp_right_offset + n * sizeof(std::uint64_t))
+        throw Error<SuffixArray>("Truncated index file " + path);
+
+    index.text_view = std::string_view(data + text_offset, n);
+    index.sa = std::span(reinterpret_cast<const std::uint64_t *>(data + sa_offset), n);
+    index.lcp_left = std::span(reinterpret_cast<const std::uint64_t *>(data + lcp_left_offset), n);
+    index.lcp_right = std::span(reinterpret_cast<const std::uint64_t *>(data + lcp_right_offset), n);
+    index.storage = std::move(mapping);
+    return index;
+}
+
+void SuffixArray::save(const std::string& path) const
+{
+    std::ofstream ofs {path, std::ios_base::binary};
+    if (!ofs)
+        throw Error<SuffixArray>("Failed to create the index file " + path);
+    const std::uint64_t n = size();
+    const char padding[8] = {};
+    ofs.write(index_magic, sizeof(index_magic));
+    ofs.write(reinterpret_cast<const char *>(&n), sizeof(n));
+    ofs.write(text_view.data(), n);
+    ofs.write(padding, padded_size(n) - n);
+    ofs.write(reinterpret_cast<const char *>(sa.data()), n * sizeof(std::uint64_t));
+    ofs.write(reinterpret_cast<const char *>(lcp_left.data()), n * sizeof(std::uint64_t));
+    ofs.write(reinterpret_cast<const char *>(lcp_right.data()), n * sizeof(std::uint64_t));
+    if (!ofs)
+        throw Error<SuffixArray>("Failed to write the index file " + path);
+}
+
+std::pair<std::size_t, std::size_t> SuffixArray::find_range(std::string_view pat) const
+{
+    const std::size_t n = size(), m = pat.size();
+
+    // compare the suffix with the pattern, skipping the k characters known to match; k is updated
+    auto compare = [&](std::size_t pos, std::size_t& k)
+    {
+        while (k < m && pos + k < n && text_view[pos + k] == pat[k])
+            ++k;
+        if (k == m)
+            return 0;
+        if (pos + k == n)
+            return -1;
+        return static_cast<unsigned char>(text_view[pos + k]) < static_cast<unsigned char>(pat[k]) ? -1 : 1;
+    };
+
+    // find the first suffix that goes after the pattern: the suffixes whose first m characters are less
+    // than the pattern go before it, and for the upper bound the ones starting with the pattern too.
+    // The bounds lo and hi are positions p = i + 1 as in build_search_lcps, lo going before the pattern
+    // and hi after it, and lcp_lo and lcp_hi are their LCPs with the pattern. Comparing the LCP of the middle
+    // with the closer bound to that bound's LCP with the pattern either decides the step: more means
+    // that the middle differs from the pattern where the bound does, less that the middle differs from the bound
+    // where the bound still matches, or leaves the comparison to resume where the bound stopped matching
+    auto bound = [&](bool upper)
+    {
+        std::size_t lo = 0, hi = n + 1, lcp_lo = 0, lcp_hi = 0;
+        while (hi - lo > 1) {
+            const std::size_t mid = lo + (hi - lo) / 2;
+            const bool from_lo = lcp_lo >= lcp_hi;
+            const std::size_t lcp_bound = from_lo ? lcp_left[mid - 1] : lcp_right[mid - 1];
+            std::size_t k = from_lo ? lcp_lo : lcp_hi;
+            bool goes_before;
+            if (lcp_bound > k) {
+                goes_before = from_lo;
+            } else if (lcp_bound < k) {
+                goes_before = !from_lo;
+                k = lcp_bound;
+            } else {
+                const int cmp = compare(sa[mid - 1], k);
+                goes_before = cmp < 0 || (upper && cmp == 0);
+            }
+            if (goes_before) {
+                lo = mid;
+                lcp_lo = k;
+            } else {
+                hi = mid;
+                lcp_hi = k;
+            }
+        }
+        return lo;
+    };
+
+    const std::size_t first = bound(false);
+    return {first, bound(true)};
+}
+
+std::size_t SuffixArray::count(std::string_view pat) const
+{
+    const auto [first, last] = find_range(pat);
+    return last - first;
+}
+
+std::vector<std::size_t> SuffixArray::locate(std::string_view pat) const
+{
+    const auto [first, last] = find_range(pat);
+    std::vector<std::size_t> positions (sa.begin() + first, sa.begin() + last);
+    std::sort(positions.begin(), positions.end());
+    return positions;
+}
@@ -0,0 +1,53 @@
+#include <gtest/gtest.h>
+
+#include "aho_corasick.h"
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+
+static std::string gen_string(size_t size)
+{
+    std::string s (size, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % 3;
+    return s;
+}
+
+
+TEST(AhoCorasick, FindAll)
+{
+    std::vector<std::string> pattern_storage;
+    for (int i = 0; i < 30; ++i)
+        pattern_storage.push_back(gen_string(rand() % 5 + 1));
+    pattern_storage.push_back(pattern_storage.front()); // duplicates are reported under both ids
+    pattern_storage.push_back("xyz"); // never matches
+    const std::vector<std::string_view> patterns (pattern_storage.begin(), pattern_storage.end());
+    const std::string text = gen_string(2000);
+
+    const AhoCorasick automaton {patterns};
+    auto matches = automaton.find_all(text);
+
+    std::vector<std::pair<size_t, size_t>> actual, expected;
+    for (auto [pattern_id, offset] : matches)
+        actual.emplace_back(offset, pattern_id);
+    for (size_t id = 0; id < patterns.size(); ++id)
+        for (size_t offset = text.find(patterns[id]); offset != std::string::npos; offset = text.find(patterns[id], offset + 1))
+            expected.emplace_back(offset, id);
+    std::sort(actual.begin(), actual.end());
+    std::sort(expected.begin(), expected.end());
+
+    EXPECT_EQ(actual, expected);
+    EXPECT_EQ(automaton.count(text), expected.size());
+}
+
+TEST(AhoCorasick, NestedPatterns)
+{
+    const AhoCorasick automaton {{"he", "she", "his", "hers"}};
+    const auto matches = automaton.find_all("ushers");
+    ASSERT_EQ(matches.size(), 3);
+    EXPECT_EQ(matches[0].pattern_id, 1); EXPECT_EQ(matches[0].offset, 1);
+    EXPECT_EQ(matches[1].pattern_id, 0); EXPECT_EQ(matches[1].offset, 2);
+    EXPECT_EQ(matches[2].pattern_id, 3); EXPECT_EQ(matches[2].offset, 2);
+}
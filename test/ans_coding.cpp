@@ -0,0 +1,117 @@
+#include "ans_coding.h"
+#include "error.h"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+
+static std::string gen_skewed_text(size_t size)
+{
+    std::string text(size, 'a');
+    for (char& c : text)
+        if (rand() % 10 == 0)
+            c = static_cast<char>('b' + rand() % 8);
+    return text;
+}
+
+static size_t huffman_encoded_size(const std::string& text)
+{
+    std::ostringstream oss {std::ios_base::binary};
+    HuffmanStringEncoder encoder {oss, text.begin(), text.end()};
+    encoder.write_syms(text.begin(), text.end());
+    encoder.finalize();
+    return oss.str().size();
+}
+
+
+TEST(AnsCoding, RansEncodeDecode)
+{
+    const std::string text = gen_skewed_text(rand() % 10'000 + 10'000);
+    AnsModel<char> model {text.begin(), text.end()};
+
+    std::ostringstream oss {std::ios_base::binary};
+    {
+        RansEncoder<char> encoder {oss, model};
+        encoder.write_syms(text.begin(), text.end());
+    }
+    EXPECT_LT(oss.str().size(), huffman_encoded_size(text));
+
+    std::istringstream iss {oss.str(), std::ios_base::binary};
+    RansDecoder<char> decoder {iss, model};
+    std::string decoded_text(text.size(), '\0');
+    decoder.read_syms(decoded_text.begin(), decoded_text.end());
+
+    EXPECT_EQ(text, decoded_text);
+    EXPECT_FALSE(decoder.get_sym());
+}
+
+TEST(AnsCoding, TansEncodeDecode)
+{
+    const std::string text = gen_skewed_text(rand() % 10'000 + 10'000);
+    TansTable<char> table {text.begin(), text.end()};
+
+    std::ostringstream oss {std::ios_base::binary};
+    {
+        TansEncoder<char> encoder {oss, table};
+        encoder.write_syms(text.begin(), text.end());
+    }
+    EXPECT_LT(oss.str().size(), huffman_encoded_size(text));
+
+    std::istringstream iss {oss.str(), std::ios_base::binary};
+    TansDecoder<char> decoder {iss, table};
+    std::string decoded_text(text.size(), '\0');
+    decoder.read_syms(decoded_text.begin(), decoded_text.end());
+
+    EXPECT_EQ(text, decoded_text);
+    EXPECT_FALSE(decoder.get_sym());
+}
+
+TEST(AnsCoding, MultipleBlocks)
+{
+    const std::string first = gen_skewed_text(1000), second = gen_skewed_text(3);
+    const std::string text = first + second;
+    TansTable<char> table {text.begin(), text.end()};
+
+    std::ostringstream oss {std::ios_base::binary};
+    TansEncoder<char> encoder {oss, table};
+    encoder.write_syms(first.begin(), first.end());
+    encoder.finalize();
+    encoder.write_syms(second.begin(), second.end());
+    encoder.finalize();
+
+    std::istringstream iss {oss.str(), std::ios_base::binary};
+    TansDecoder<char> decoder {iss, table};
+    std::string decoded_text;
+    while (auto opt_symbol = decoder.get_sym())
+        decoded_text.push_back(*opt_symbol);
+
+    EXPECT_EQ(text, decoded_text);
+}
+
+TEST(AnsCoding, TansCorruptHeader)
+{
+    const std::string text = gen_skewed_text(1000);
+    TansTable<char> table {text.begin(), text.end()};
+
+    std::ostringstream oss {std::ios_base::binary};
+    TansEncoder<char> encoder {oss, table};
+    encoder.write_syms(text.begin(), text.end());
+    encoder.finalize();
+    const std::string encoded = oss.str();
+
+    // the block header is the 8-byte count, the 4-byte final state and the 1-byte padding
+    std::string bad_padding = encoded;
+    bad_padding[12] = static_cast<char>(200);
+    std::istringstream padding_iss {bad_padding, std::ios_base::binary};
+    TansDecoder<char> padding_decoder {padding_iss, table};
+    EXPECT_THROW(padding_decoder.get_sym(), AbstractError);
+
+    std::string bad_state = encoded;
+    std::fill(bad_state.begin() + 8, bad_state.begin() + 12, static_cast<char>(0xFF));
+    std::istringstream state_iss {bad_state, std::ios_base::binary};
+    TansDecoder<char> state_decoder {state_iss, table};
+    EXPECT_THROW(state_decoder.get_sym(), AbstractError);
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+
+#include "approximate_search.h"
+#include "error.h"
+
+#include <algorithm>
+#include <string>
+
+
+static std::string gen_string(size_t size, int alphabet)
+{
+    std::string s (size, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % alphabet;
+    return s;
+}
+
+/* Brute force: matches ending at each position with at most k mismatches. */
+static std::vector<ApproximateMatch> hamming_matches(const std::string& s, const std::string& pat, unsigned k)
+{
+    std::vector<ApproximateMatch> matches;
+    for (size_t i = 0; i + pat.size() <= s.size(); ++i) {
+        unsigned errors = 0;
+        for (size_t j = 0; j < pat.size(); ++j)
+            errors += s[i + j] != pat[j];
+        if (errors <= k)
+            matches.push_back({i + pat.size(), errors});
+    }
+    return matches;
+}
+
+/* Brute force: matches ending at each position with edit distance at most k. */
+static std::vector<ApproximateMatch> edit_matches(const std::string& s, const std::string& pat, unsigned k)
+{
+    const size_t m = pat.size();
+    std::vector<size_t> column (m + 1);
+    for (size_t i = 0; i <= m; ++i)
+        column[i] = i;
+    std::vector<ApproximateMatch> matches;
+    for (size_t j = 0; j < s.size(); ++j) {
+        size_t diag = column[0];
+        column[0] = 0;
+        for (size_t i = 1; i <= m; ++i) {
+            const size_t up = column[i];
+            column[i] = std::min({up + 1, column[i - 1] + 1, diag + (pat[i - 1] != s[j])});
+            diag = up;
+        }
+        if (column[m] <= k)
+            matches.push_back({j + 1, static_cast<unsigned>(column[m])});
+    }
+    return matches;
+}
+
+
+TEST(ApproximateSearch, Bitap)
+{
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const std::string s = gen_string(rand() % 400, 3);
+        const std::string pat = gen_string(attempt % 4 ? rand() % 12 + 1 : rand() % 100 + 60, 3);
+        const unsigned k = rand() % std::min<size_t>(pat.size(), 4);
+
+        const BitapPattern pattern {pat, k};
+        const auto expected = hamming_matches(s, pat, k);
+        EXPECT_EQ(pattern.find_all(s), expected) << "s=" << s << " pat=" << pat << " k=" << k;
+        EXPECT_EQ(pattern.count(s), expected.size());
+        EXPECT_EQ(pattern.find(s), expected.empty() ? std::nullopt : std::optional(expected.front()));
+    }
+}
+
+TEST(ApproximateSearch, Myers)
+{
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const std::string s = gen_string(rand() % 400, 3);
+        const std::string pat = gen_string(attempt % 4 ? rand() % 12 + 1 : rand() % 150 + 60, 3);
+        const unsigned k = rand() % std::min<size_t>(pat.size(), pat.size() > 60 ? 40 : 4);
+
+        const MyersPattern pattern {pat, k};
+        const auto expected = edit_matches(s, pat, k);
+        EXPECT_EQ(pattern.find_all(s), expected) << "s=" << s << " pat=" << pat << " k=" << k;
+        EXPECT_EQ(pattern.count(s), expected.size());
+    }
+
+    const MyersPattern pattern {"connection refused", 2};
+    EXPECT_EQ(pattern.find("error: conection refusd by peer"), (ApproximateMatch {23, 2}));
+    EXPECT_THROW(MyersPattern("ab", 2), AbstractError);
+}
+
+TEST(ApproximateSearch, Streaming)
+{
+    const std::string s = gen_string(1000, 2), pat = gen_string(70, 2);
+    const MyersPattern pattern {pat, 20};
+    ApproximateStreamMatcher matcher {pattern};
+    std::vector<ApproximateMatch> matches;
+    for (size_t pos = 0; pos < s.size();) {
+        const size_t chunk_size = std::min<size_t>(rand() % 50, s.size() - pos);
+        for (const ApproximateMatch& match : matcher.feed(std::span(s.data() + pos, chunk_size)))
+            matches.push_back(match);
+        pos += chunk_size;
+    }
+    EXPECT_EQ(matches, pattern.find_all(s));
+    EXPECT_EQ(matcher.position(), s.size());
+}
@@ -0,0 +1,50 @@
+#include <gtest/gtest.h>
+
+#include "bit_io.h"
+
+#include <sstream>
+#include <utility>
+#include <vector>
+
+
+TEST(BitIO, WriteRead)
+{
+    std::vector<std::pair<uint64_t, unsigned>> chunks (rand() % 1000 + 1000);
+    for (auto& [bits, nr_bits] : chunks) {
+        nr_bits = rand() % (BitWriter::max_put_bits + 1);
+        bits = (uint64_t(rand()) << 32 | rand()) & ((uint64_t(1) << nr_bits) - 1);
+    }
+
+    std::ostringstream oss {std::ios_base::binary};
+    size_t total_bits = 0;
+    {
+        BitWriter writer {oss};
+        for (auto [bits, nr_bits] : chunks) {
+            writer.put(bits | ~uint64_t(0) << nr_bits, nr_bits); // bits above nr_bits must be ignored
+            total_bits += nr_bits;
+        }
+    }
+    EXPECT_EQ(oss.str().size(), (total_bits + 7) / 8);
+
+    std::istringstream iss {oss.str(), std::ios_base::binary};
+    BitReader reader {iss};
+    for (auto [bits, nr_bits] : chunks) {
+        ASSERT_GE(reader.available(), std::min(nr_bits, BitReader::max_peek_bits));
+        EXPECT_EQ(reader.peek(nr_bits), bits);
+        reader.consume(nr_bits);
+    }
+    EXPECT_LT(reader.available(), 8);
+    EXPECT_EQ(reader.get(reader.available()), 0); // zero padding
+    EXPECT_EQ(reader.available(), 0);
+}
+
+TEST(BitIO, ByteOrder)
+{
+    std::ostringstream oss {std::ios_base::binary};
+    BitWriter writer {oss};
+    writer.put(0b101, 3);
+    writer.put(0b11110, 5);
+    writer.put(0b1, 1);
+    writer.flush();
+    EXPECT_EQ(oss.str(), std::string("\xBE\x80", 2));
+}
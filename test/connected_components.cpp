@@ -0,0 +1,108 @@
+#include <gtest/gtest.h>
+
+#include "connected_components.h"
+#include "union_find.h"
+#include "error.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+
+/* Random graph: two dense clusters, so that the sampling finds a giant component, and sparse random edges
+ * from the other vertices, which leave small components and isolated vertices. */
+static std::vector<GraphEdge> gen_graph(std::uint32_t nr_vertices)
+{
+    std::vector<GraphEdge> edges;
+    const std::uint32_t cluster_size = nr_vertices / 4;
+    for (std::uint32_t cluster = 0; cluster < 2; ++cluster)
+        for (std::uint32_t i = 0; i < 12 * cluster_size; ++i)
+            edges.push_back({cluster * cluster_size + rand() % cluster_size, cluster * cluster_size + rand() % cluster_size});
+    for (std::uint32_t i = 0; i < nr_vertices / 8; ++i)
+        edges.push_back({2 * cluster_size + rand() % (nr_vertices - 2 * cluster_size), rand() % nr_vertices});
+    std::shuffle(edges.begin(), edges.end(), std::mt19937(nr_vertices));
+    return edges;
+}
+
+/* Label the vertices with the sequential forest, numbering the components by their smallest vertices. */
+static ConnectedComponents expected_components(const std::vector<GraphEdge>& edges, std::uint32_t nr_vertices)
+{
+    UnionFind<std::uint32_t> uf (nr_vertices);
+    for (auto [u, v] : edges)
+        uf.merge(u, v);
+    ConnectedComponents components;
+    std::vector<std::uint32_t> root_label (nr_vertices, UINT32_MAX);
+    for (std::uint32_t v = 0; v < nr_vertices; ++v) {
+        std::uint32_t& label = root_label[uf.find(v)];
+        if (label == UINT32_MAX)
+            label = static_cast<std::uint32_t>(components.count++);
+        components.labels.push_back(label);
+    }
+    return components;
+}
+
+
+TEST(ConnectedComponents, RandomGraphs)
+{
+    for (std::uint32_t nr_vertices : {1u, 100u, 5000u, 70000u}) {
+        const std::vector<GraphEdge> edges = gen_graph(nr_vertices);
+        const ConnectedComponents expected = expected_components(edges, nr_vertices);
+        for (unsigned nr_threads : {1u, 3u, 8u}) {
+            const ConnectedComponents from_edges = connected_components(edges, nr_vertices, nr_threads);
+            EXPECT_EQ(from_edges.count, expected.count);
+            EXPECT_EQ(from_edges.labels, expected.labels) << "nr_vertices=" << nr_vertices << " nr_threads=" << nr_threads;
+            const ConnectedComponents from_csr = connected_components(build_csr(edges, nr_vertices, nr_threads), nr_threads);
+            EXPECT_EQ(from_csr.count, expected.count);
+            EXPECT_EQ(from_csr.labels, expected.labels) << "nr_vertices=" << nr_vertices << " nr_threads=" << nr_threads;
+        }
+    }
+}
+
+TEST(ConnectedComponents, Grid)
+{
+    // a lattice with its middle column missing: two halves and the isolated vertices of the column;
+    // the vertices have about five edges each, so a sample of the edges is merged before the rest are filtered
+    constexpr std::uint32_t side = 300, gap = side / 2;
+    std::vector<GraphEdge> edges;
+    auto add_edge = [&](std::uint32_t x, std::uint32_t y, std::uint32_t to_x, std::uint32_t to_y)
+    {
+        if (x != gap && to_x != gap && to_x < side && to_y < side)
+            edges.push_back({y * side + x, to_y * side + to_x});
+    };
+    for (std::uint32_t y = 0; y < side; ++y)
+        for (std::uint32_t x = 0; x < side; ++x) {
+            add_edge(x, y, x + 1, y);
+            add_edge(x, y, x, y + 1);
+            add_edge(x, y, x + 1, y + 1);
+            add_edge(x, y, x - 1, y + 1); // x - 1 wraps around to an invalid column for x = 0
+            add_edge(x, y, x, y + 2);
+        }
+    ASSERT_GT(edges.size(), 4 * side * side + 1);
+
+    const ConnectedComponents expected = expected_components(edges, side * side);
+    EXPECT_EQ(expected.count, 2 + side);
+    for (unsigned nr_threads : {1u, 4u}) {
+        EXPECT_EQ(connected_components(edges, side * side, nr_threads).labels, expected.labels);
+        EXPECT_EQ(connected_components(build_csr(edges, side * side, nr_threads), nr_threads).labels, expected.labels);
+    }
+}
+
+TEST(ConnectedComponents, Csr)
+{
+    const std::vector<GraphEdge> edges = {{0, 1}, {2, 0}, {3, 3}, {1, 2}};
+    const CsrGraph graph = build_csr(edges, 5, 1);
+    EXPECT_EQ(graph.nr_vertices(), 5);
+    EXPECT_EQ(graph.offsets, (std::vector<std::size_t> {0, 2, 4, 6, 8, 8}));
+    EXPECT_EQ(graph.neighbors, (std::vector<std::uint32_t> {1, 2, 0, 2, 0, 1, 3, 3}));
+    EXPECT_EQ(connected_components(graph).labels, (std::vector<std::uint32_t> {0, 0, 0, 1, 2}));
+}
+
+TEST(ConnectedComponents, EdgeCases)
+{
+    EXPECT_EQ(connected_components(std::vector<GraphEdge> {}, 0).count, 0);
+    EXPECT_EQ(connected_components(CsrGraph {}).count, 0);
+    EXPECT_EQ(connected_components(std::vector<GraphEdge> {}, 3).labels, (std::vector<std::uint32_t> {0, 1, 2}));
+    EXPECT_THROW(connected_components(std::vector<GraphEdge> {{0, 3}}, 3), AbstractError);
+    EXPECT_THROW(build_csr(std::vector<GraphEdge> {{3, 0}}, 3), AbstractError);
+    EXPECT_THROW(connected_components(CsrGraph {{0, 1, 1}, {2}}), AbstractError);
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+#include "fm_index.h"
+
+
+static std::string gen_skewed_string(size_t size)
+{
+    std::string s (size, 'a');
+    for (char& c : s)
+        if (rand() % 3 == 0)
+            c = 'b' + rand() % (rand() % 2 ? 2 : 10);
+    return s;
+}
+
+
+TEST(FmIndex, CountAndLocate)
+{
+    for (int attempt = 0; attempt < 20; ++attempt) {
+        const std::string text = gen_skewed_string(rand() % 3000);
+        const FmIndex index {text, static_cast<size_t>(rand() % 16 + 1)};
+        for (int query = 0; query < 30; ++query) {
+            std::string pat = gen_skewed_string(rand() % 5 + 1);
+            if (query % 3 == 0 && text.size() > 10)
+                pat = text.substr(rand() % (text.size() - 10), rand() % 10 + 1);
+            std::vector<size_t> expected;
+            for (size_t i = text.find(pat); i != std::string::npos; i = text.find(pat, i + 1))
+                expected.push_back(i);
+            EXPECT_EQ(index.locate(pat), expected) << "pat=" << pat;
+            EXPECT_EQ(index.count(pat), expected.size()) << "pat=" << pat;
+        }
+        EXPECT_EQ(index.count("z"), 0);
+    }
+}
+
+TEST(FmIndex, DegenerateTexts)
+{
+    const FmIndex empty {""};
+    EXPECT_EQ(empty.count("a"), 0);
+    EXPECT_EQ(empty.count(""), 0);
+
+    const FmIndex single_symbol {"aaaaaaa", 3};
+    EXPECT_EQ(single_symbol.count("aaa"), 5);
+    EXPECT_EQ(single_symbol.locate("aaaaaa"), (std::vector<size_t> {0, 1}));
+    EXPECT_EQ(single_symbol.count("b"), 0);
+    EXPECT_EQ(single_symbol.locate(""), (std::vector<size_t> {0, 1, 2, 3, 4, 5, 6}));
+
+    std::string all_bytes;
+    for (int c = 0; c < 256; ++c)
+        all_bytes += static_cast<char>(c);
+    const FmIndex binary {all_bytes + all_bytes};
+    EXPECT_EQ(binary.locate(std::string("\0\1", 2)), (std::vector<size_t> {0, 256}));
+}
+
+TEST(FmIndex, MemoryUsage)
+{
+    const std::string text = gen_skewed_string(1 << 16);
+    const FmIndex index {text};
+    EXPECT_LT(index.memory_usage(), text.size());
+}
@@ -2,6 +2,7 @@
 
 #include <gtest/gtest.h>
 
+#include <bit>
 #include <sstream>
 
 
@@ -34,3 +35,121 @@ TEST(HuffmanCoding, EncodeDecode)
 
     EXPECT_EQ(sample_text, decoded_sample_text);
 }
+
+TEST(HuffmanCoding, SharedDictionary)
+{
+    const std::vector<std::string> corpus = {
+        R"({"id":1,"level":"info","msg":"started"})",
+        R"({"id":2,"level":"warn","msg":"disk almost full"})",
+        R"({"id":3,"level":"info","msg":"request served"})",
+    };
+    auto trained = HuffmanDictionary<char>::train(corpus.begin(), corpus.end());
+
+    std::stringstream saved {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+    trained.save(saved);
+    const auto dictionary = HuffmanDictionary<char>::load(saved);
+
+    // symbols such as '#' and 'Z' never appear in the corpus but are still encodable
+    for (std::string message : {R"({"id":4,"level":"error","msg":"#Zero"})", R"({"id":5,"level":"info","msg":"stopped"})"}) {
+        std::ostringstream oss {std::ios_base::binary};
+        {
+            HuffmanStringEncoder encoder {oss, dictionary};
+            encoder << std::string_view(message.c_str(), message.size() + 1);
+        }
+        EXPECT_LT(oss.str().size(), message.size());
+
+        std::istringstream iss {oss.str(), std::ios_base::binary};
+        HuffmanStringDecoder decoder {iss, dictionary};
+        std::string decoded_message;
+        decoder >> decoded_message;
+
+        EXPECT_EQ(message, decoded_message);
+    }
+}
+
+TEST(HuffmanCoding, CorruptDictionary)
+{
+    // a run of non-leaf nodes must be rejected by its depth, not overflow the stack
+    std::stringstream deep {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+    deep.write("HUFD\x01", 5);
+    deep << std::string(1 << 21, '\0');
+    EXPECT_THROW(HuffmanDictionary<char>::load(deep), AbstractError);
+
+    // a full tree of depth 9 has 512 leaves, more than the distinct single byte symbols
+    std::string full;
+    for (int leaf = 0; leaf < 512; ++leaf) {
+        full.append(std::countr_zero(static_cast<unsigned>(leaf | 512)), '\0');
+        full += '\x01';
+        full += static_cast<char>(leaf);
+    }
+    std::stringstream wide {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+    wide.write("HUFD\x01", 5);
+    wide << full;
+    EXPECT_THROW(HuffmanDictionary<char>::load(wide), AbstractError);
+}
+
+TEST(HuffmanCoding, EntropyEstimate)
+{
+    EXPECT_DOUBLE_EQ(estimate_entropy(std::unordered_map<char, size_t> {{'a', 5}}), 0);
+    EXPECT_DOUBLE_EQ(estimate_entropy(std::unordered_map<char, size_t> {{'a', 5}, {'b', 5}}), 1);
+    EXPECT_DOUBLE_EQ(estimate_entropy(std::unordered_map<char, size_t> {{'a', 2}, {'b', 1}, {'c', 1}}), 1.5);
+    EXPECT_EQ(estimate_encoded_size(std::unordered_map<char, size_t> {{'a', 6}, {'b', 2}, {'c', 2}, {'d', 2}}), 3);
+}
+
+TEST(HuffmanCoding, BlockModes)
+{
+    std::string incompressible(4096, '\0');
+    for (char& c : incompressible)
+        c = static_cast<char>(rand());
+    const std::string single_symbol(1000, 'x');
+    const std::string text = sample_text;
+
+    std::stringstream ss {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+    EXPECT_EQ(huffman_encode_block(ss, incompressible.begin(), incompressible.end()), HuffmanBlockMode::Stored);
+    EXPECT_EQ(huffman_encode_block(ss, single_symbol.begin(), single_symbol.end()), HuffmanBlockMode::SingleSymbol);
+    EXPECT_EQ(huffman_encode_block(ss, text.begin(), text.end()), HuffmanBlockMode::Huffman);
+    EXPECT_LT(ss.str().size(), incompressible.size() + 17 + 25 + text.size() + 17);
+
+    for (const std::string& expected : {incompressible, single_symbol, text}) {
+        std::string decoded;
+        ASSERT_TRUE(huffman_decode_block<char>(ss, std::back_inserter(decoded)));
+        EXPECT_EQ(decoded, expected);
+    }
+    std::string rest;
+    EXPECT_FALSE(huffman_decode_block<char>(ss, std::back_inserter(rest)));
+}
+
+TEST(HuffmanCoding, BlockForgedSizes)
+{
+    // the header is the mode, the 8-byte count and the 8-byte payload size, followed by a short payload
+    auto decode_forged = [](HuffmanBlockMode mode, uint64_t count, uint64_t payload_size)
+    {
+        std::stringstream ss {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+        ss.put(static_cast<char>(mode));
+        __write_le<uint64_t>(ss, count);
+        __write_le<uint64_t>(ss, payload_size);
+        ss << "payload";
+        std::string decoded;
+        huffman_decode_block<char>(ss, std::back_inserter(decoded));
+    };
+    EXPECT_THROW(decode_forged(HuffmanBlockMode::Stored, 7, uint64_t(1) << 62), AbstractError);
+    EXPECT_THROW(decode_forged(HuffmanBlockMode::SingleSymbol, 7, 7), AbstractError);
+    EXPECT_THROW(decode_forged(HuffmanBlockMode::Huffman, 7, 7), AbstractError);
+    EXPECT_THROW(decode_forged(static_cast<HuffmanBlockMode>(3), 7, 7), AbstractError);
+    // a plausible size for a forged count must fail on the missing bytes, not on allocating them
+    EXPECT_THROW(decode_forged(HuffmanBlockMode::Stored, uint64_t(1) << 60, uint64_t(1) << 60), AbstractError);
+    EXPECT_THROW(decode_forged(HuffmanBlockMode::Huffman, uint64_t(1) << 60, uint64_t(1) << 59), AbstractError);
+}
+
+TEST(HuffmanCoding, BlockDeepDictionary)
+{
+    // a Huffman block whose dictionary is a magic followed by a long run of zero bytes (non-leaf nodes)
+    const std::string payload = std::string("HUFD\x01", 5) + std::string(2 << 20, '\0');
+    std::stringstream ss {std::ios_base::in | std::ios_base::out | std::ios_base::binary};
+    ss.put(static_cast<char>(HuffmanBlockMode::Huffman));
+    __write_le<uint64_t>(ss, uint64_t(1) << 22);
+    __write_le<uint64_t>(ss, payload.size());
+    ss << payload;
+    std::string decoded;
+    EXPECT_THROW(huffman_decode_block<char>(ss, std::back_inserter(decoded)), AbstractError);
+}
@@ -0,0 +1,54 @@
+#include "huffman_search.h"
+
+#include <gtest/gtest.h>
+
+#include <sstream>
+#include <string>
+#include <vector>
+
+
+TEST(HuffmanSearch, StrFind)
+{
+    const std::vector<std::string> corpus = {
+        "2024-01-01 INFO request served in 12ms\n",
+        "2024-01-01 WARN disk almost full\n",
+        "2024-01-02 ERROR connection reset by peer\n",
+    };
+    const auto dictionary = HuffmanDictionary<char>::train(corpus.begin(), corpus.end());
+    std::string log;
+    for (int i = 0; i < 20; ++i)
+        log += corpus[rand() % corpus.size()];
+    log += "2024-01-03 ERROR out of memory\n";
+
+    std::ostringstream oss {std::ios_base::binary};
+    {
+        HuffmanStringEncoder encoder {oss, dictionary};
+        encoder.write(log);
+    }
+
+    for (std::string_view pat : {"ERROR out", "WARN", "01-02", "\n2024-01-03", "memory\n", "FATAL", ""}) {
+        std::istringstream iss {oss.str(), std::ios_base::binary};
+        EXPECT_EQ(huffman_str_find(iss, dictionary, pat, log.size()), log.find(pat)) << "pattern: " << pat;
+    }
+}
+
+TEST(HuffmanSearch, LimitedNumberOfSymbols)
+{
+    const std::string text = "abracadabra";
+    auto tree = build_huffman_tree(text.begin(), text.end());
+
+    std::ostringstream oss {std::ios_base::binary};
+    {
+        HuffmanEncoder<char> encoder {oss, tree.get()};
+        encoder.write_syms(text.begin(), text.end());
+    }
+
+    const std::string pattern = "cad";
+    std::istringstream iss {oss.str(), std::ios_base::binary};
+    HuffmanDecoder<char> decoder {iss, *tree};
+    EXPECT_EQ(huffman_find_pattern(decoder, pattern.begin(), pattern.size(), 7), 4);
+
+    std::istringstream iss_short {oss.str(), std::ios_base::binary};
+    HuffmanDecoder<char> decoder_short {iss_short, *tree};
+    EXPECT_EQ(huffman_find_pattern(decoder_short, pattern.begin(), pattern.size(), 6), std::nullopt);
+}
@@ -0,0 +1,58 @@
+# Test of the kmp_grep tool: its exit codes, its option parsing and the order of its output.
+# Run by ctest as: cmake -DKMP_GREP=<path of kmp_grep> -DWORK_DIR=<scratch directory> -P kmp_grep.cmake
+
+file(REMOVE_RECURSE ${WORK_DIR})
+file(MAKE_DIRECTORY ${WORK_DIR})
+file(WRITE ${WORK_DIR}/a.txt "foo\nbar foo\nbaz\n")
+file(WRITE ${WORK_DIR}/b.txt "nothing here\n")
+file(WRITE ${WORK_DIR}/c.txt "aaaaaa\nxaax\nbbb\naa")
+
+# the output of these spans many chunks, so it must still come out in the order of the files and lines
+set(big_a "")
+set(big_b "")
+set(expected_big "")
+foreach(i RANGE 1 6000)
+    string(APPEND big_a "line ${i} foo\n")
+    string(APPEND big_b "other ${i} foo\nskipped\n")
+endforeach()
+foreach(i RANGE 1 6000)
+    string(APPEND expected_big "${WORK_DIR}/big_a.txt:line ${i} foo\n")
+endforeach()
+foreach(i RANGE 1 6000)
+    string(APPEND expected_big "${WORK_DIR}/big_b.txt:other ${i} foo\n")
+endforeach()
+file(WRITE ${WORK_DIR}/big_a.txt "${big_a}")
+file(WRITE ${WORK_DIR}/big_b.txt "${big_b}")
+
+# Run kmp_grep with the arguments and check its exit code and, unless expected_output is IGNORE, its output.
+function(check expected_code expected_output)
+    execute_process(COMMAND ${KMP_GREP} ${ARGN}
+        RESULT_VARIABLE code OUTPUT_VARIABLE output ERROR_VARIABLE error)
+    if(NOT code STREQUAL expected_code)
+        message(SEND_ERROR "kmp_grep ${ARGN}: exit code ${code} instead of ${expected_code}\n${error}")
+    elseif(NOT expected_output STREQUAL "IGNORE" AND NOT output STREQUAL expected_output)
+        message(SEND_ERROR "kmp_grep ${ARGN}: unexpected output\n${output}")
+    endif()
+endfunction()
+
+check(0 "foo\nbar foo\n" foo ${WORK_DIR}/a.txt)
+check(0 "${WORK_DIR}/a.txt:foo\n${WORK_DIR}/a.txt:bar foo\n" -j 1 foo ${WORK_DIR}/a.txt ${WORK_DIR}/b.txt)
+check(0 "${WORK_DIR}/a.txt:2\n${WORK_DIR}/b.txt:0\n" -c foo ${WORK_DIR}/a.txt ${WORK_DIR}/b.txt)
+check(0 "0\n8\n" -b foo ${WORK_DIR}/a.txt)
+check(1 "" foo ${WORK_DIR}/b.txt)
+# overlapping matches, several matches per line and a last line without a newline
+check(0 "0\n1\n2\n3\n4\n8\n16\n" -b aa ${WORK_DIR}/c.txt)
+check(0 "7\n" -c -b aa ${WORK_DIR}/c.txt)
+check(0 "aaaaaa\nxaax\naa\n" aa ${WORK_DIR}/c.txt)
+check(0 "aaaaaa\nxaax\n" "a\nx" ${WORK_DIR}/c.txt)
+check(2 IGNORE foo ${WORK_DIR}/a.txt ${WORK_DIR}/missing.txt)
+check(0 "${expected_big}" -j 2 foo ${WORK_DIR}/big_a.txt ${WORK_DIR}/big_b.txt)
+
+# invalid options print the usage and exit with 2
+check(2 "" -j 0 foo ${WORK_DIR}/a.txt)
+check(2 "" -j abc foo ${WORK_DIR}/a.txt)
+check(2 "" -j 3x foo ${WORK_DIR}/a.txt)
+check(2 "" -j -1 foo ${WORK_DIR}/a.txt)
+check(2 "" -j 99999999999999999999 foo ${WORK_DIR}/a.txt)
+check(2 "" -x foo ${WORK_DIR}/a.txt)
+check(2 "" foo)
@@ -2,6 +2,8 @@
 
 #include "kmp_pattern_search.h"
 
+#include <algorithm>
+
 
 TEST(KmpPatternSearch, StrFind)
 {
@@ -23,3 +25,300 @@ TEST(KmpPatternSearch, SeqFind)
     EXPECT_EQ(it - seq.begin(), i_pat);
 }
 
+
+TEST(KmpPatternSearch, SelfOverlappingPattern)
+{
+    std::vector<int> lps(7);
+    const std::string pattern = "aabaaab";
+    build_lps(pattern.begin(), lps.begin(), pattern.size());
+    EXPECT_EQ(lps, (std::vector<int> {0, 1, 0, 1, 2, 2, 3}));
+
+    const std::string s = "aabaabaaaabaabaaab";
+    EXPECT_EQ(kmp_str_find(s, pattern), s.find(pattern));
+    EXPECT_EQ(kmp_str_find(s, "aab"), s.find("aab"));
+    EXPECT_EQ(kmp_str_find(s, "abaaa"), s.find("abaaa"));
+    EXPECT_EQ(kmp_str_find(s, "aaaaa"), std::string::npos);
+    EXPECT_EQ(kmp_str_find(s, ""), 0);
+}
+
+TEST(KmpPatternSearch, DfaFind)
+{
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::string s (rand() % 200, '\0'), pat (rand() % 6, '\0');
+        for (char& c : s)
+            c = 'a' + rand() % 3;
+        for (char& c : pat)
+            c = 'a' + rand() % 3;
+
+        const KmpDfa dfa {pat};
+        EXPECT_EQ(dfa.find(s), s.find(pat)) << "s=" << s << " pat=" << pat;
+
+        size_t nr_matches = 0;
+        for (size_t i = pat.empty() ? std::string::npos : s.find(pat); i != std::string::npos; i = s.find(pat, i + 1))
+            ++nr_matches;
+        EXPECT_EQ(dfa.count(s), nr_matches) << "s=" << s << " pat=" << pat;
+    }
+}
+
+TEST(KmpPatternSearch, FastStrFind)
+{
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+    for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        if (level <= detect_simd_level())
+            levels.push_back(level);
+
+    for (SimdLevel level : levels) {
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            std::string s (rand() % 300, '\0'), pat (rand() % 8, '\0');
+            for (char& c : s)
+                c = 'a' + rand() % 3;
+            for (char& c : pat)
+                c = 'a' + rand() % 3;
+            EXPECT_EQ(fast_str_find(s, pat, level), s.find(pat)) << "s=" << s << " pat=" << pat;
+        }
+
+        // every position of the second pattern is a candidate, which triggers the KMP fallback
+        const std::string s = std::string(100'000, 'a') + 'b';
+        EXPECT_EQ(fast_str_find(s, std::string(1000, 'a') + 'b', level), s.size() - 1001);
+        EXPECT_EQ(fast_str_find(s, std::string(1000, 'a') + 'c' + 'a', level), std::string::npos);
+    }
+}
+
+template<std::ranges::range Range>
+static std::vector<size_t> to_vector(Range&& range)
+{
+    std::vector<size_t> v;
+    std::ranges::copy(range, std::back_inserter(v));
+    return v;
+}
+
+TEST(KmpPatternSearch, FindAll)
+{
+    static_assert(std::ranges::view<KmpMatchView> && std::ranges::forward_range<KmpMatchView>);
+
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::string s (rand() % 200, '\0'), pat (rand() % 5 + 1, '\0');
+        for (char& c : s)
+            c = 'a' + rand() % 2;
+        for (char& c : pat)
+            c = 'a' + rand() % 2;
+
+        std::vector<size_t> overlapping, non_overlapping;
+        for (size_t i = s.find(pat); i != std::string::npos; i = s.find(pat, i + 1))
+            overlapping.push_back(i);
+        for (size_t i = s.find(pat); i != std::string::npos; i = s.find(pat, i + pat.size()))
+            non_overlapping.push_back(i);
+
+        EXPECT_EQ(to_vector(kmp_find_all(s, pat)), overlapping) << "s=" << s << " pat=" << pat;
+        EXPECT_EQ(to_vector(kmp_find_all(s, pat, KmpMatchMode::NonOverlapping)), non_overlapping)
+            << "s=" << s << " pat=" << pat;
+
+        EXPECT_EQ(kmp_count(s, pat), overlapping.size());
+        EXPECT_EQ(kmp_count(s, pat, KmpMatchMode::NonOverlapping), non_overlapping.size());
+    }
+
+    EXPECT_EQ(to_vector(kmp_find_all("abababab", "aba") | std::views::take(2)), (std::vector<size_t> {0, 2}));
+    EXPECT_TRUE(kmp_find_all("abc", "").empty());
+}
+
+TEST(KmpPatternSearch, EmptyPatternCount)
+{
+    const std::string s = "abc";
+    EXPECT_EQ(kmp_count(s, ""), 0);
+    EXPECT_EQ(kmp_count(s, "", KmpMatchMode::NonOverlapping), 0);
+    EXPECT_EQ(KmpPattern("").count(s), 0);
+    EXPECT_EQ(kmp_parallel_count(s, KmpPattern(""), 2), 0);
+    EXPECT_EQ(KmpDfa("").count(s), 0);
+    static_assert(KmpFixedPattern<"">::count("abc") == 0);
+
+    std::size_t nr_matches = 0;
+    KmpStreamMatcher("").feed(s, [&nr_matches](std::size_t) { ++nr_matches; });
+    EXPECT_EQ(nr_matches, 0);
+
+    EXPECT_EQ(KmpPattern("").find(s), 0);
+    EXPECT_EQ(KmpDfa("").find(s), 0);
+}
+
+TEST(KmpPatternSearch, CompiledPattern)
+{
+    constexpr KmpPattern inline_pattern {"abaab"};
+    static_assert(inline_pattern.size() == 5 && inline_pattern.pattern() == "abaab");
+
+    const std::string long_pat = std::string(KmpPattern::inline_capacity, 'a') + "baa";
+    const KmpPattern heap_pattern {long_pat};
+    EXPECT_EQ(heap_pattern.pattern(), long_pat);
+
+    const std::string s = "abaabaab" + long_pat + "b" + long_pat.substr(1) + "baa";
+    for (const KmpPattern *pattern : {&inline_pattern, &heap_pattern}) {
+        const std::string_view pat = pattern->pattern();
+        std::vector<size_t> expected;
+        for (size_t i = s.find(pat); i != std::string::npos; i = s.find(pat, i + 1))
+            expected.push_back(i);
+
+        EXPECT_EQ(pattern->find(s), s.find(pat));
+        EXPECT_EQ(to_vector(pattern->find_all(s)), expected);
+        EXPECT_EQ(pattern->count(s), expected.size());
+    }
+}
+
+TEST(KmpPatternSearch, StreamMatcher)
+{
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        std::string s (rand() % 300, '\0'), pat (rand() % 6 + 1, '\0');
+        for (char& c : s)
+            c = 'a' + rand() % 2;
+        for (char& c : pat)
+            c = 'a' + rand() % 2;
+        const KmpMatchMode mode = attempt % 2 ? KmpMatchMode::Overlapping : KmpMatchMode::NonOverlapping;
+
+        KmpStreamMatcher matcher {pat, mode};
+        std::vector<size_t> matches;
+        for (size_t pos = 0; pos < s.size();) {
+            const size_t chunk_size = std::min<size_t>(rand() % 4, s.size() - pos);
+            for (size_t match : matcher.feed(std::span(s.data() + pos, chunk_size)))
+                matches.push_back(match);
+            pos += chunk_size;
+        }
+        EXPECT_EQ(matcher.position(), s.size());
+        EXPECT_EQ(matches, to_vector(kmp_find_all(s, pat, mode))) << "s=" << s << " pat=" << pat;
+    }
+}
+
+TEST(KmpPatternSearch, ParallelSearch)
+{
+    std::string s (1 << 20, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % 4;
+    for (const std::string& pat : {std::string("abcab"), std::string("dddddddd"), s.substr(s.size() - 20)}) {
+        const KmpPattern pattern {pat};
+        const std::vector<size_t> expected = to_vector(pattern.find_all(s));
+        for (unsigned nr_threads : {1u, 3u, 8u}) {
+            EXPECT_EQ(kmp_parallel_find(s, pattern, nr_threads), s.find(pat));
+            EXPECT_EQ(kmp_parallel_find_all(s, pattern, nr_threads), expected);
+            EXPECT_EQ(kmp_parallel_count(s, pattern, nr_threads), expected.size());
+        }
+    }
+    EXPECT_EQ(kmp_parallel_find(s, KmpPattern("e")), std::string::npos);
+}
+
+TEST(KmpPatternSearch, HorspoolAndTwoWay)
+{
+    for (int attempt = 0; attempt < 2000; ++attempt) {
+        const int alphabet = attempt % 2 ? 2 : 4;
+        std::string s (rand() % 100, '\0'), pat (rand() % 8, '\0');
+        for (char& c : s)
+            c = 'a' + rand() % alphabet;
+        for (char& c : pat)
+            c = 'a' + rand() % alphabet;
+        EXPECT_EQ(horspool_str_find(s, pat), s.find(pat)) << "s=" << s << " pat=" << pat;
+        EXPECT_EQ(two_way_str_find(s, pat), s.find(pat)) << "s=" << s << " pat=" << pat;
+    }
+
+    // non-byte characters and custom comparisons
+    std::vector<int> seq (200);
+    for (int& x : seq)
+        x = rand() % 3;
+    const std::vector<int> pat (seq.begin() + 150, seq.begin() + 160);
+    const auto expected = std::search(seq.begin(), seq.end(), pat.begin(), pat.end());
+    EXPECT_EQ(horspool_find_pattern(seq.begin(), seq.end(), pat.begin(), pat.size()), expected);
+    EXPECT_EQ(two_way_find_pattern(seq.begin(), seq.end(), pat.begin(), pat.size()), expected);
+
+    auto fold_equal = [](char a, char b) { return std::tolower(a) == std::tolower(b); };
+    auto fold_hash = [](char c) { return std::hash<char>()(std::tolower(c)); };
+    auto fold_less = [](char a, char b) { return std::tolower(a) < std::tolower(b); };
+    const std::string s = "The Quick Brown Fox", p = "bROWN";
+    EXPECT_EQ(horspool_find_pattern(s.begin(), s.end(), p.begin(), p.size(), fold_equal, fold_hash) - s.begin(), 10);
+    EXPECT_EQ(two_way_find_pattern(s.begin(), s.end(), p.begin(), p.size(), fold_less) - s.begin(), 10);
+}
+
+TEST(KmpPatternSearch, BackendSelection)
+{
+    EXPECT_EQ(select_str_find_backend("ab"), StrFindBackend::Simd);
+    EXPECT_EQ(select_str_find_backend("the quick brown fox jumps over the lazy dog"), StrFindBackend::Simd);
+    EXPECT_EQ(select_str_find_backend(std::string(64, 'A') + "CGT"), StrFindBackend::Horspool);
+    EXPECT_EQ(select_str_find_backend(std::string(32, '0') + "1"), StrFindBackend::TwoWay);
+    EXPECT_EQ(select_str_find_backend(std::string(10'000, '0') + "1"), StrFindBackend::TwoWay);
+
+    std::string s (5000, '\0');
+    for (char& c : s)
+        c = '0' + rand() % 2;
+    for (size_t size : {2, 8, 20, 100}) {
+        const std::string pat = s.substr(s.size() - size);
+        EXPECT_EQ(str_find(s, pat), s.find(pat)) << to_string(select_str_find_backend(pat));
+    }
+}
+
+TEST(KmpPatternSearch, CaseInsensitiveAndUnicode)
+{
+    auto fold = [](std::string s)
+    {
+        for (char& c : s)
+            c = ascii_fold(c);
+        return s;
+    };
+    std::vector<SimdLevel> levels = {SimdLevel::Scalar};
+    for (SimdLevel level : {SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512})
+        if (level <= detect_simd_level())
+            levels.push_back(level);
+    for (SimdLevel level : levels) {
+        for (int attempt = 0; attempt < 200; ++attempt) {
+            std::string s (rand() % 300, '\0'), pat (rand() % 6, '\0');
+            for (char& c : s)
+                c = "aAbB@`[{"[rand() % 8];
+            for (char& c : pat)
+                c = "aAbB@`[{"[rand() % 8];
+            EXPECT_EQ(fast_str_find_icase(s, pat, level), fold(s).find(fold(pat))) << "s=" << s << " pat=" << pat;
+        }
+        const std::string s = std::string(100'000, 'a') + 'B';
+        EXPECT_EQ(fast_str_find_icase(s, std::string(1000, 'A') + 'b', level), s.size() - 1001);
+    }
+
+    // "é" is C3 A9 and "©" is C2 A9, so the partial sequences occur inside them as bytes
+    const std::string text = "caf\xC3\xA9 \xC2\xA9 caf";
+    EXPECT_EQ(utf8_str_find(text, "\xC2\xA9"), 6);
+    EXPECT_EQ(utf8_str_find(text, "caf"), 0);
+    EXPECT_EQ(utf8_str_find(text, "\xA9"), std::string::npos);
+    EXPECT_EQ(utf8_str_find(text, "f\xC3"), std::string::npos);
+    EXPECT_EQ(text.find("f\xC3"), 2);
+
+    const std::u16string s16 = u"Größenwahn und Übermut";
+    EXPECT_EQ(kmp_str_find(std::u16string_view(s16), u"Über"), s16.find(u"Über"));
+    const std::u32string s32 = U"日本語のテキスト";
+    EXPECT_EQ(kmp_str_find(std::u32string_view(s32), U"テキ"), s32.find(U"テキ"));
+    EXPECT_EQ(kmp_str_find(std::u32string_view(s32), U"テス"), std::u32string::npos);
+}
+
+TEST(KmpPatternSearch, FixedPattern)
+{
+    constexpr std::array<int, 7> lps = []
+    {
+        std::array<int, 7> lps {};
+        build_lps("aabaaab", lps.begin(), 7);
+        return lps;
+    }();
+    static_assert(lps == std::array<int, 7> {0, 1, 0, 1, 2, 2, 3});
+    static_assert(kmp_find_pattern(std::string_view("xxaabaaabx").begin(), std::string_view("xxaabaaabx").end(),
+                "aabaaab", 7) - std::string_view("xxaabaaabx").begin() == 2);
+
+    using Short = KmpFixedPattern<"aab">;
+    using Mid = KmpFixedPattern<"abababababababababab">;
+    using Long = KmpFixedPattern<"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab">;
+    static_assert(Short::find("abaabaab") == 2 && Short::count("abaabaab") == 2);
+    static_assert(Mid::find("ab") == std::string_view::npos);
+
+    std::string s (3000, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % 2;
+    s += Long::pattern();
+    s += s.substr(0, 1000);
+    auto check = [&s](auto pattern)
+    {
+        const std::string_view pat = pattern.pattern();
+        EXPECT_EQ(pattern.find(s), s.find(pat)) << pat;
+        EXPECT_EQ(pattern.count(s), kmp_count(s, pat)) << pat;
+    };
+    check(Short());
+    check(Mid());
+    check(Long());
+    check(KmpFixedPattern<"bbbbbbbba">());
+}
@@ -0,0 +1,133 @@
+#include <gtest/gtest.h>
+
+#include "rabin_karp.h"
+#include "error.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+static std::string gen_string(size_t size)
+{
+    std::string s (size, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % 3;
+    return s;
+}
+
+
+TEST(RabinKarp, FindAll)
+{
+    // texts shorter and longer than a block, so that both the lanes and the scalar tail are covered
+    for (size_t text_size : {3, 100, 5000, 40000}) {
+        std::vector<std::string> pattern_storage;
+        for (int i = 0; i < 300; ++i)
+            pattern_storage.push_back(gen_string(6));
+        pattern_storage.push_back(pattern_storage.front()); // duplicates are reported under both ids
+        pattern_storage.push_back("xyzxyz"); // never matches
+        const std::vector<std::string_view> patterns (pattern_storage.begin(), pattern_storage.end());
+        const std::string text = gen_string(text_size);
+
+        const RabinKarp searcher {patterns};
+        const auto matches = searcher.find_all(text);
+        EXPECT_TRUE(std::is_sorted(matches.begin(), matches.end(), [](const auto& a, const auto& b)
+                    {
+                        return a.offset < b.offset;
+                    }));
+
+        std::vector<std::pair<size_t, size_t>> actual, expected;
+        for (auto [pattern_id, offset] : matches)
+            actual.emplace_back(offset, pattern_id);
+        for (size_t id = 0; id < patterns.size(); ++id)
+            for (size_t offset = text.find(patterns[id]); offset != std::string::npos; offset = text.find(patterns[id], offset + 1))
+                expected.emplace_back(offset, id);
+        std::sort(actual.begin(), actual.end());
+        std::sort(expected.begin(), expected.end());
+
+        EXPECT_EQ(actual, expected);
+        EXPECT_EQ(searcher.count(text), expected.size());
+    }
+}
+
+TEST(RabinKarp, LongPatterns)
+{
+    const std::string text = std::string(20000, 'a') + "b" + std::string(20000, 'a');
+    const std::string prefix = text.substr(0, 3000), middle = text.substr(18500, 3000);
+    const RabinKarp searcher {{prefix, middle}};
+    EXPECT_EQ(searcher.pattern_size(), 3000);
+    EXPECT_EQ(searcher.count(text), 2 * (20000 - 3000 + 1) + 1);
+    const auto matches = searcher.find_all(text);
+    EXPECT_EQ(std::count_if(matches.begin(), matches.end(), [](const auto& match)
+                {
+                    return match.pattern_id == 1;
+                }), 1);
+}
+
+TEST(RabinKarp, BinaryText)
+{
+    std::string text (10000, '\0');
+    for (char& c : text)
+        c = static_cast<char>(rand() % 4 * 85);
+    std::vector<std::string_view> patterns;
+    for (int i = 0; i < 50; ++i)
+        patterns.push_back(std::string_view(text).substr(rand() % (text.size() - 5), 5));
+
+    size_t expected = 0;
+    for (std::string_view pattern : patterns)
+        for (size_t offset = text.find(pattern); offset != std::string::npos; offset = text.find(pattern, offset + 1))
+            ++expected;
+    EXPECT_EQ(RabinKarp(patterns).count(text), expected);
+}
+
+TEST(RabinKarp, ThueMorseCollisions)
+{
+    auto thue_morse = [](size_t size, char zero, char one)
+    {
+        std::string s (size, zero);
+        for (size_t i = 0; i < size; ++i)
+            if (std::popcount(i) & 1)
+                s[i] = one;
+        return s;
+    };
+    auto wrapping_hash = [](std::string_view s, std::uint32_t base)
+    {
+        std::uint32_t h = 0;
+        for (char c : s)
+            h = h * base + static_cast<unsigned char>(c);
+        return h;
+    };
+    // the Thue-Morse string of 256 bytes and its complement collide modulo 2^32 for every odd base
+    const std::string t = thue_morse(256, 'a', 'b'), complement = thue_morse(256, 'b', 'a');
+    for (std::uint32_t base : {1u, 3u, 257u, 0x9E3779B1u, 0xFFFFFFFFu})
+        ASSERT_EQ(wrapping_hash(t, base), wrapping_hash(complement, base));
+
+    // so do all the windows made of the two at the multiples of 256, which the patterns are too:
+    // every such window passes the table, only a few of them match, and the candidates overlap
+    std::string text;
+    for (int i = 0; i < 200; ++i)
+        text += rand() % 2 ? t : complement;
+    const std::vector<std::string> patterns {t + complement, complement + complement, t + t};
+    const RabinKarp searcher {{patterns[0], patterns[1], patterns[2]}};
+
+    std::vector<std::pair<size_t, size_t>> expected;
+    for (size_t id = 0; id < patterns.size(); ++id)
+        for (size_t offset = text.find(patterns[id]); offset != std::string::npos;
+                offset = text.find(patterns[id], offset + 1))
+            expected.emplace_back(offset, id);
+    std::sort(expected.begin(), expected.end());
+    std::vector<std::pair<size_t, size_t>> found;
+    for (const auto& match : searcher.find_all(text))
+        found.emplace_back(match.offset, match.pattern_id);
+    EXPECT_EQ(found, expected);
+}
+
+TEST(RabinKarp, InvalidPatterns)
+{
+    EXPECT_THROW(RabinKarp({"abc", "ab"}), AbstractError);
+    EXPECT_THROW(RabinKarp({""}), AbstractError);
+    const RabinKarp empty {{}};
+    EXPECT_EQ(empty.count("abc"), 0);
+}
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include "string_structure.h"
+
+#include <algorithm>
+#include <string>
+
+
+static std::string gen_string(size_t size, int alphabet)
+{
+    std::string s (size, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % alphabet;
+    return s;
+}
+
+/* Test strings: random ones over small alphabets, and Fibonacci words, which are full of repetitions. */
+static std::vector<std::string> gen_strings()
+{
+    std::vector<std::string> strings = {"", "a", "aa", "ab", "abaababaab", "aabaaab", "mississippi"};
+    for (int attempt = 0; attempt < 200; ++attempt)
+        strings.push_back(gen_string(rand() % 60 + 1, attempt % 4 + 1));
+    std::string fib_prev = "a", fib = "ab";
+    while (fib.size() < 300) {
+        strings.push_back(fib);
+        fib_prev = std::exchange(fib, fib + fib_prev);
+    }
+    return strings;
+}
+
+static bool has_period(std::string_view s, size_t p)
+{
+    for (size_t i = 0; i + p < s.size(); ++i)
+        if (s[i] != s[i + p])
+            return false;
+    return true;
+}
+
+
+TEST(StringStructure, ZArray)
+{
+    for (const std::string& s : gen_strings()) {
+        const auto z = build_z_array(s);
+        ASSERT_EQ(z.size(), s.size());
+        for (size_t i = 0; i < s.size(); ++i) {
+            size_t len = 0;
+            while (i + len < s.size() && s[len] == s[i + len])
+                ++len;
+            ASSERT_EQ(z[i], len) << "s=" << s << " i=" << i;
+        }
+    }
+    static_assert([]
+            {
+                std::array<int, 7> z {};
+                build_z_array("aabaaab", z.begin(), 7);
+                return z == std::array<int, 7> {7, 1, 0, 2, 3, 1, 0};
+            }());
+}
+
+TEST(StringStructure, SmallAlphabetLps)
+{
+    for (const std::string& s : gen_strings())
+        ASSERT_EQ(build_lps_small_alphabet(s), build_lps(s)) << "s=" << s;
+
+    std::string wide;
+    for (int c = 0; c < 40; ++c)
+        wide += std::string(3, static_cast<char>('0' + c)) + "0";
+    EXPECT_EQ(build_lps_small_alphabet(wide), build_lps(wide));
+}
+
+TEST(StringStructure, Periods)
+{
+    EXPECT_EQ(shortest_period(""), 0);
+    EXPECT_EQ(shortest_period("abcabcab"), 3);
+    EXPECT_EQ(all_periods("abaababaab"), (std::vector<size_t> {5, 8, 10}));
+
+    for (const std::string& s : gen_strings()) {
+        std::vector<size_t> expected;
+        for (size_t p = 1; p <= s.size(); ++p)
+            if (has_period(s, p))
+                expected.push_back(p);
+        ASSERT_EQ(all_periods(s), expected) << "s=" << s;
+        ASSERT_EQ(shortest_period(s), expected.empty() ? 0 : expected.front());
+    }
+}
+
+TEST(StringStructure, BorderTree)
+{
+    for (const std::string& s : gen_strings()) {
+        const BorderTree tree {s};
+        ASSERT_EQ(tree.size(), s.size() + 1);
+        auto is_border = [&](size_t k, size_t i)
+        {
+            return k <= i && s.compare(0, k, s, i - k, k) == 0;
+        };
+        for (int query = 0; query < 100 && !s.empty(); ++query) {
+            const size_t i = rand() % (s.size() + 1), j = rand() % (s.size() + 1), k = rand() % (i + 1);
+            ASSERT_EQ(tree.is_border(k, i), is_border(k, i)) << "s=" << s << " k=" << k << " i=" << i;
+            size_t expected = std::min(i, j);
+            while (!is_border(expected, i) || !is_border(expected, j))
+                --expected;
+            ASSERT_EQ(tree.longest_common_border(i, j), expected) << "s=" << s << " i=" << i << " j=" << j;
+        }
+    }
+    const BorderTree tree {"aabaaab"};
+    EXPECT_EQ(tree.parent(7), 3);
+    EXPECT_EQ(tree.depth(7), 2);
+}
+
+TEST(StringStructure, Runs)
+{
+    EXPECT_EQ(find_runs("mississippi"), (std::vector<StringRun> {{1, 8, 3}, {2, 4, 1}, {5, 7, 1}, {8, 10, 1}}));
+
+    for (const std::string& s : gen_strings()) {
+        // maximal segments with period p that are at least twice as long, kept if p is their smallest period
+        std::vector<StringRun> expected;
+        for (size_t p = 1; 2 * p <= s.size(); ++p) {
+            for (size_t start = 0; start + p < s.size();) {
+                size_t end = start;
+                while (end + p < s.size() && s[end] == s[end + p])
+                    ++end;
+                const std::string_view run = std::string_view(s).substr(start, end + p - start);
+                if (end - start >= p && shortest_period(run) == p)
+                    expected.push_back({start, end + p, p});
+                start = end + 1;
+            }
+        }
+        std::sort(expected.begin(), expected.end(), [](const StringRun& a, const StringRun& b)
+                {
+                    return a.start != b.start ? a.start < b.start : a.end < b.end;
+                });
+        ASSERT_EQ(find_runs(s), expected) << "s=" << s;
+        ASSERT_LT(expected.size(), std::max<size_t>(s.size(), 1));
+    }
+}
+
+TEST(StringStructure, Batch)
+{
+    const std::vector<std::string> strings = gen_strings();
+    std::string data;
+    std::vector<size_t> offsets {0};
+    for (const std::string& s : strings) {
+        data += s;
+        offsets.push_back(data.size());
+    }
+    const StringBatch batch {data, offsets};
+    ASSERT_EQ(batch.size(), strings.size());
+
+    std::vector<std::uint32_t> lps (data.size()), z (data.size()), periods (batch.size());
+    batch_build_lps(batch, lps);
+    batch_build_z_array(batch, z);
+    batch_shortest_periods(batch, periods);
+    for (size_t k = 0; k < batch.size(); ++k) {
+        ASSERT_EQ(batch[k], strings[k]);
+        const auto expected_lps = build_lps(strings[k]), expected_z = build_z_array(strings[k]);
+        EXPECT_TRUE(std::equal(expected_lps.begin(), expected_lps.end(), lps.begin() + offsets[k]));
+        EXPECT_TRUE(std::equal(expected_z.begin(), expected_z.end(), z.begin() + offsets[k]));
+        EXPECT_EQ(periods[k], shortest_period(strings[k]));
+    }
+}
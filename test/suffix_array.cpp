@@ -0,0 +1,125 @@
+#include <gtest/gtest.h>
+
+#include "suffix_array.h"
+#include "error.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+
+static std::string gen_string(size_t size, int alphabet)
+{
+    std::string s (size, '\0');
+    for (char& c : s)
+        c = 'a' + rand() % alphabet;
+    return s;
+}
+
+
+TEST(SuffixArray, Construction)
+{
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const std::string text = attempt % 10 ? gen_string(rand() % 500, attempt % 4 + 1)
+            : std::string(rand() % 100, 'a') + "b" + std::string(rand() % 100, 'a');
+
+        std::vector<std::uint64_t> expected (text.size());
+        for (size_t i = 0; i < text.size(); ++i)
+            expected[i] = i;
+        std::sort(expected.begin(), expected.end(), [&](size_t a, size_t b)
+                {
+                    return text.compare(a, std::string::npos, text, b, std::string::npos) < 0;
+                });
+        const auto sa = build_suffix_array(text);
+        ASSERT_EQ(sa, expected) << "text=" << text;
+
+        const auto lcp = build_lcp_array(text, sa, 3);
+        for (size_t i = 1; i < text.size(); ++i) {
+            size_t h = 0;
+            while (sa[i] + h < text.size() && sa[i - 1] + h < text.size() && text[sa[i] + h] == text[sa[i - 1] + h])
+                ++h;
+            EXPECT_EQ(lcp[i], h);
+        }
+    }
+}
+
+TEST(SuffixArray, CountAndLocate)
+{
+    const SuffixArray index {gen_string(5000, 3)};
+    const std::string text {index.text()};
+    for (int attempt = 0; attempt < 100; ++attempt) {
+        const std::string pat = gen_string(rand() % 8 + 1, 3);
+        std::vector<size_t> expected;
+        for (size_t i = text.find(pat); i != std::string::npos; i = text.find(pat, i + 1))
+            expected.push_back(i);
+        EXPECT_EQ(index.locate(pat), expected) << "pat=" << pat;
+        EXPECT_EQ(index.count(pat), expected.size());
+    }
+    EXPECT_EQ(index.count(""), text.size());
+    EXPECT_EQ(index.count("d"), 0);
+}
+
+TEST(SuffixArray, RepetitiveText)
+{
+    // long runs and repeats make the search steps decide from the precomputed LCPs deep into the pattern
+    for (int attempt = 0; attempt < 50; ++attempt) {
+        const std::string unit = gen_string(rand() % 6 + 1, 2);
+        std::string text;
+        while (text.size() < 2000)
+            text += rand() % 8 ? unit : gen_string(rand() % 3 + 1, 2);
+        const SuffixArray index {text};
+        for (int query = 0; query < 20; ++query) {
+            const size_t pos = rand() % text.size();
+            std::string pat = text.substr(pos, rand() % 300 + 1);
+            if (query % 4 == 0)
+                pat.back() = pat.back() == 'a' ? 'b' : 'a';
+            std::vector<size_t> expected;
+            for (size_t i = text.find(pat); i != std::string::npos; i = text.find(pat, i + 1))
+                expected.push_back(i);
+            ASSERT_EQ(index.locate(pat), expected) << "text=" << text << " pat=" << pat;
+        }
+    }
+}
+
+TEST(SuffixArray, SaveLoad)
+{
+    const std::string path = testing::TempDir() + "suffix_array_test.idx";
+    const SuffixArray index {"mississippi banana"};
+    index.save(path);
+    {
+        const SuffixArray loaded = SuffixArray::load(path);
+        EXPECT_EQ(loaded.text(), index.text());
+        EXPECT_TRUE(std::ranges::equal(loaded.suffix_array(), index.suffix_array()));
+        EXPECT_EQ(loaded.locate("ssi"), (std::vector<size_t> {2, 5}));
+        EXPECT_EQ(loaded.count("ana"), 2);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SuffixArray, LoadForgedSize)
+{
+    const std::string path = testing::TempDir() + "suffix_array_forged.idx";
+    SuffixArray {"abracadabra"}.save(path);
+    std::string data;
+    {
+        std::ifstream ifs {path, std::ios_base::binary};
+        data.assign(std::istreambuf_iterator<char>(ifs), {});
+    }
+    // these sizes give the size of the file for 11 positions in wrapping arithmetic, 2^64 - 1 a huge one
+    for (std::uint64_t n : {0x3D70A3D70A3D70AFu, 0xCCCCCCCCCCCCCCD8u, ~std::uint64_t(0)}) {
+        std::memcpy(data.data() + 8, &n, sizeof(n));
+        std::ofstream {path, std::ios_base::binary}.write(data.data(), data.size());
+        EXPECT_THROW(SuffixArray::load(path), AbstractError);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(SuffixArray, Move)
+{
+    SuffixArray index {"short"};
+    const SuffixArray moved = std::move(index);
+    EXPECT_EQ(moved.text(), "short");
+    EXPECT_EQ(moved.locate("o"), (std::vector<size_t> {2}));
+}
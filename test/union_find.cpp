@@ -2,6 +2,12 @@
 
 #include "union_find.h"
 
+#include <algorithm>
+#include <numeric>
+#include <thread>
+#include <utility>
+#include <vector>
+
 TEST(UnionFindTest, InitResizing)
 {
     UnionFind uf (rand() % 100 + 50);
@@ -26,3 +32,125 @@ TEST(UnionFindTest, MergeFind)
         EXPECT_TRUE(uf.connected(k, i)) << "find(k)=" << uf.find(k) << " find(i)=" << uf.find(i);
     }
 }
+
+/* Merge random pairs and compare the sets with labels relabeled naively on every merge. */
+template<typename UF>
+static void check_against_labels()
+{
+    UF uf (200);
+    std::vector<int> label (uf.size());
+    for (int i = 0; i < static_cast<int>(uf.size()); ++i)
+        label[i] = i;
+    for (int merge_count = 0; merge_count < 300; ++merge_count) {
+        const int i = rand() % uf.size(), j = rand() % uf.size();
+        const int from = label[j], to = label[i];
+        EXPECT_EQ(uf.merge(i, j), from != to);
+        for (int& l : label)
+            if (l == from)
+                l = to;
+        const int k = rand() % uf.size();
+        EXPECT_EQ(std::as_const(uf).connected(i, k), label[i] == label[k]);
+        EXPECT_EQ(uf.connected(j, k), label[j] == label[k]);
+        if constexpr (requires { uf.set_size(i); }) {
+            EXPECT_EQ(uf.set_size(k), static_cast<std::size_t>(std::count(label.begin(), label.end(), label[k])));
+        }
+    }
+}
+
+TEST(UnionFindTest, Variants)
+{
+    check_against_labels<UnionFind<int, UnionFindLinking::BySize, UnionFindCompression::Halving>>();
+    check_against_labels<UnionFind<int, UnionFindLinking::BySize, UnionFindCompression::Splitting>>();
+    check_against_labels<UnionFind<int, UnionFindLinking::ByRank, UnionFindCompression::Halving>>();
+    check_against_labels<UnionFind<short, UnionFindLinking::ByRank, UnionFindCompression::Splitting>>();
+}
+
+TEST(UnionFindTest, Compression)
+{
+    // pairwise merges of equal blocks build a binomial tree of height 10
+    constexpr int size = 1024;
+    UnionFind<int, UnionFindLinking::BySize, UnionFindCompression::Splitting> uf (size);
+    for (int half = 1; half < size; half *= 2)
+        for (int i = 0; i + half < size; i += 2 * half)
+            uf.merge(i, i + half);
+    auto depth = [&uf](int p)
+    {
+        int d = 0;
+        for (; p != 0; ++d)
+            p = uf.parent(p);
+        return d;
+    };
+    EXPECT_EQ(depth(1023), 10);
+    EXPECT_EQ(uf.set_size(1023), 1024);
+    // splitting points every node of the path at its grandparent, halving the depth of each
+    EXPECT_EQ(uf.find(1023), 0);
+    EXPECT_EQ(depth(1023), 5);
+    EXPECT_EQ(depth(1022), 5);
+    EXPECT_EQ(depth(1020), 4);
+}
+
+/* Merge random pairs from several threads, checking the merges each thread sees meanwhile,
+ * and compare the final sets with the sequential forest. */
+template<typename CUF>
+static void check_concurrent(bool roots_are_minimums)
+{
+    constexpr int size = 20000, nr_threads = 8, nr_merges = 2000;
+    std::vector<std::pair<int, int>> pairs (nr_threads * nr_merges);
+    for (auto& [i, j] : pairs)
+        i = rand() % size, j = rand() % size;
+
+    CUF cuf (size);
+    std::vector<int> nr_joined (nr_threads), nr_missed (nr_threads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < nr_threads; ++t)
+        threads.emplace_back([&, t]
+                {
+                    for (int k = t * nr_merges; k < (t + 1) * nr_merges; ++k) {
+                        nr_joined[t] += cuf.merge(pairs[k].first, pairs[k].second);
+                        nr_missed[t] += !cuf.connected(pairs[k].second, pairs[k].first);
+                    }
+                });
+    for (std::thread& thread : threads)
+        thread.join();
+
+    UnionFind uf (size);
+    int expected_joined = 0;
+    for (auto [i, j] : pairs)
+        expected_joined += uf.merge(i, j);
+    EXPECT_EQ(std::accumulate(nr_joined.begin(), nr_joined.end(), 0), expected_joined);
+    EXPECT_EQ(std::count(nr_missed.begin(), nr_missed.end(), 0), nr_threads);
+
+    std::vector<int> minimum (size, size);
+    for (int i = 0; i < size; ++i)
+        minimum[uf.find(i)] = std::min(minimum[uf.find(i)], i);
+    for (int i = 0; i < size; ++i) {
+        ASSERT_EQ(cuf.connected(i, minimum[uf.find(i)]), true);
+        if (roots_are_minimums) {
+            ASSERT_EQ(cuf.find(i), minimum[uf.find(i)]);
+        }
+        ASSERT_LE(cuf.parent(i), roots_are_minimums ? i : size);
+    }
+    for (int query = 0; query < 1000; ++query) {
+        const int i = rand() % size, j = rand() % size;
+        ASSERT_EQ(cuf.connected(i, j), uf.connected(i, j));
+    }
+}
+
+TEST(ConcurrentUnionFindTest, ConcurrentMerges)
+{
+    check_concurrent<ConcurrentUnionFind<int>>(true);
+    check_concurrent<ConcurrentUnionFind<int, ConcurrentUnionFindLinking::ByRandomIndex>>(false);
+    check_concurrent<ConcurrentUnionFind<long, ConcurrentUnionFindLinking::ByRandomIndex>>(false);
+}
+
+TEST(ConcurrentUnionFindTest, LinkingOrder)
+{
+    // merging neighbors from the top down links each new root under the next, into a path the finds must halve
+    ConcurrentUnionFind<short> cuf (1000);
+    for (int i = 998; i >= 0; --i)
+        EXPECT_TRUE(cuf.merge(i + 1, i));
+    EXPECT_FALSE(cuf.merge(0, 999));
+    EXPECT_EQ(cuf.find(999), 0);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(cuf.find(i), 0);
+}
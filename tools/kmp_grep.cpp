@@ -0,0 +1,337 @@
+/*
+ * kmp_grep: searches files for a fixed string with the pattern search module and prints the matching lines
+ * or the byte offsets of the matches. Files are memory-mapped for sequential access and searched in parallel.
+ * The pattern is compiled once into a KmpPattern, and each file is searched in one resumable scan of its matches,
+ * so the search takes O(n + m) time whatever the number of matches.
+ * With --stats, the total size, time and throughput are printed to stderr, so it doubles as an end-to-end
+ * benchmark of the substring search on real files.
+ * The output of each file is passed to the main thread in bounded chunks and printed in the order of the files;
+ * a worker ahead of the file being printed waits once it has buffered max_buffered bytes, so the memory used
+ * does not grow with the size of the output.
+ * The exit status is 0 if anything matched, 1 if nothing did and 2 on errors.
+ *
+ * Usage: kmp_grep [-c] [-b] [-j THREADS] [--stats] PATTERN FILE...
+ *   -c          print only the number of matching lines (or of matches with -b) per file
+ *   -b          print the byte offsets of all (possibly overlapping) matches instead of the lines
+ *   -j THREADS  number of files searched in parallel (default: hardware concurrency)
+ *   --stats     print the throughput to stderr
+ * */
+
+#include "kmp_pattern_search.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+struct Options {
+    bool count = false;
+    bool offsets = false;
+    bool stats = false;
+    unsigned nr_threads = 0;
+    std::string pattern;
+    KmpPattern compiled_pattern;
+    std::vector<std::string> files;
+};
+
+/* Result of searching a file, printed once all the files before it are done. */
+struct FileResult {
+    std::string error;
+    std::size_t size = 0;
+    bool matched = false;
+};
+
+
+/* Output of the files, written by the workers in chunks and printed by the main thread in the order of the files. */
+class OrderedOutput {
+public:
+    static constexpr std::size_t chunk_size = 1 << 16;
+    static constexpr std::size_t max_buffered = 1 << 20;
+
+    explicit OrderedOutput(std::size_t nr_files) : files(nr_files) {}
+
+    /* Queue a chunk of the output of the file; wait while too much of its output is waiting to be printed. */
+    void write(std::size_t file, std::string chunk)
+    {
+        std::unique_lock lock {mutex};
+        printed.wait(lock, [&] { return files[file].nr_buffered < max_buffered; });
+        files[file].nr_buffered += chunk.size();
+        files[file].chunks.push_back(std::move(chunk));
+        queued.notify_all();
+    }
+
+    /* Mark the file as searched. */
+    void finish(std::size_t file, FileResult result)
+    {
+        std::lock_guard lock {mutex};
+        files[file].result = std::move(result);
+        files[file].done = true;
+        queued.notify_all();
+    }
+
+    /* Print the output of the file as it comes, followed by its error, and return its result. */
+    FileResult print(std::size_t file)
+    {
+        for (;;) {
+            std::unique_lock lock {mutex};
+            queued.wait(lock, [&] { return !files[file].chunks.empty() || files[file].done; });
+            if (files[file].chunks.empty()) {
+                std::cerr << files[file].result.error;
+                return files[file].result;
+            }
+            const std::string chunk = std::move(files[file].chunks.front());
+            files[file].chunks.pop_front();
+            lock.unlock();
+
+            std::cout.write(chunk.data(), chunk.size());
+            lock.lock();
+            files[file].nr_buffered -= chunk.size();
+            printed.notify_all();
+        }
+    }
+
+private:
+    struct File {
+        std::deque<std::string> chunks;
+        std::size_t nr_buffered = 0; /* Size of the chunks queued and being printed. */
+        FileResult result;
+        bool done = false;
+    };
+
+    std::mutex mutex;
+    std::condition_variable queued, printed;
+    std::vector<File> files;
+};
+
+/* Buffer of the output of one file that hands it to OrderedOutput in chunks of about chunk_size bytes. */
+class ChunkWriter {
+public:
+    ChunkWriter(OrderedOutput& output, std::size_t file) : output(output), file(file) {}
+
+    ChunkWriter(const ChunkWriter&) = delete;
+    ChunkWriter& operator=(const ChunkWriter&) = delete;
+
+    ~ChunkWriter()
+    {
+        flush();
+    }
+
+    ChunkWriter& operator<<(std::string_view str)
+    {
+        buffer.append(str);
+        if (buffer.size() >= OrderedOutput::chunk_size)
+            flush();
+        return *this;
+    }
+
+    void flush()
+    {
+        if (!buffer.empty())
+            output.write(file, std::exchange(buffer, std::string()));
+    }
+
+private:
+    OrderedOutput& output;
+    std::size_t file;
+    std::string buffer;
+};
+
+
+/* Read-only memory mapping of a whole file, advised for sequential access. */
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path)
+    {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            error = std::strerror(errno);
+            return;
+        }
+        struct stat st;
+        if (fstat(fd, &st) < 0) {
+            error = std::strerror(errno);
+        } else if (st.st_size > 0) {
+            void *const addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (addr == MAP_FAILED) {
+                error = std::strerror(errno);
+            } else {
+                madvise(addr, st.st_size, MADV_SEQUENTIAL);
+                data = static_cast<const char *>(addr);
+                size = st.st_size;
+            }
+        }
+        close(fd);
+    }
+
+    ~MappedFile()
+    {
+        if (data)
+            munmap(const_cast<char *>(data), size);
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    std::string_view view() const
+    {
+        return {data, size};
+    }
+
+    std::string error; /* Empty if the file was mapped successfully. */
+
+private:
+    const char *data = nullptr;
+    std::size_t size = 0;
+};
+
+
+/* Call on_line(line_begin, line_end) for each line containing the pattern, in order. The matches come from
+ * a single scan, which resumes where it stopped; the ones in a line already reported are skipped. */
+template<typename OnLine>
+static void for_each_matching_line(std::string_view text, const KmpPattern& pattern, OnLine&& on_line)
+{
+    std::size_t pos = 0;
+    for (std::size_t match : pattern.find_all(text, KmpMatchMode::Overlapping)) {
+        if (match < pos)
+            continue;
+        const std::size_t line_begin = text.rfind('\n', match) + 1; // npos + 1 == 0
+        std::size_t line_end = text.find('\n', match + pattern.size());
+        if (line_end == std::string_view::npos)
+            line_end = text.size();
+        on_line(line_begin, line_end);
+        pos = line_end + 1;
+    }
+}
+
+static FileResult search_file(const std::string& path, const Options& options, ChunkWriter& out)
+{
+    FileResult result;
+    const MappedFile file {path};
+    if (!file.error.empty()) {
+        result.error = "kmp_grep: " + path + ": " + file.error + '\n';
+        return result;
+    }
+    const std::string_view text = file.view();
+    result.size = text.size();
+
+    const std::string prefix = options.files.size() > 1 ? path + ':' : std::string();
+    std::size_t nr_matches = 0;
+    if (options.offsets && options.count) {
+        nr_matches = options.compiled_pattern.count(text, KmpMatchMode::Overlapping);
+    } else if (options.offsets) {
+        for (std::size_t offset : options.compiled_pattern.find_all(text, KmpMatchMode::Overlapping)) {
+            ++nr_matches;
+            out << prefix << std::to_string(offset) << "\n";
+        }
+    } else {
+        for_each_matching_line(text, options.compiled_pattern, [&](std::size_t line_begin, std::size_t line_end)
+                {
+                    ++nr_matches;
+                    if (!options.count)
+                        out << prefix << text.substr(line_begin, line_end - line_begin) << "\n";
+                });
+    }
+    if (options.count)
+        out << prefix << std::to_string(nr_matches) << "\n";
+    result.matched = nr_matches > 0;
+    return result;
+}
+
+
+static bool parse_options(int argc, char *argv[], Options& options)
+{
+    int i = 1;
+    for (; i < argc && argv[i][0] == '-' && argv[i][1]; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "-c")
+            options.count = true;
+        else if (arg == "-b")
+            options.offsets = true;
+        else if (arg == "--stats")
+            options.stats = true;
+        else if (arg == "-j" && i + 1 < argc) {
+            const std::string_view value = argv[++i];
+            const auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), options.nr_threads);
+            if (ec != std::errc() || end != value.data() + value.size() || options.nr_threads == 0)
+                return false;
+        } else if (arg == "--") {
+            ++i;
+            break;
+        } else
+            return false;
+    }
+    if (argc - i < 2)
+        return false;
+    options.pattern = argv[i++];
+    options.compiled_pattern = KmpPattern(options.pattern);
+    options.files.assign(argv + i, argv + argc);
+    return !options.pattern.empty();
+}
+
+int main(int argc, char *argv[])
+{
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "Usage: kmp_grep [-c] [-b] [-j THREADS] [--stats] PATTERN FILE..." << std::endl;
+        return 2;
+    }
+    if (options.nr_threads == 0)
+        options.nr_threads = std::max(1u, std::thread::hardware_concurrency());
+
+    const auto start = std::chrono::steady_clock::now();
+
+    // the workers take the files in order, and their output is printed in the same order as it comes
+    OrderedOutput output {options.files.size()};
+    std::atomic<std::size_t> next_file = 0;
+    std::vector<std::jthread> workers;
+    const unsigned nr_workers = std::min<std::size_t>(options.nr_threads, options.files.size());
+    for (unsigned i = 0; i < nr_workers; ++i)
+        workers.emplace_back([&]
+                {
+                    for (std::size_t f; (f = next_file.fetch_add(1)) < options.files.size();) {
+                        FileResult result;
+                        {
+                            ChunkWriter out {output, f};
+                            result = search_file(options.files[f], options, out);
+                        }
+                        output.finish(f, std::move(result));
+                    }
+                });
+
+    int status = 1;
+    std::size_t total_size = 0;
+    for (std::size_t f = 0; f < options.files.size(); ++f) {
+        const FileResult result = output.print(f);
+        if (!result.error.empty())
+            status = 2;
+        else if (result.matched && status == 1)
+            status = 0;
+        total_size += result.size;
+    }
+    std::cout.flush();
+    workers.clear();
+
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    if (options.stats)
+        std::cerr << "kmp_grep: " << total_size << " bytes in " << elapsed.count() << " s, "
+            << total_size / elapsed.count() / 1e9 << " GB/s" << std::endl;
+    return status;
+}